@@ -1,6 +1,7 @@
 #include <stdbool.h>
 #include "ExtendJson.h"
 #include "ExtendJson-test.h"
+#include <glib/gstdio.h>
 
 void setUp(void) {
 }
@@ -293,13 +294,1387 @@ static void test_with_emoji(void) {
 
   TEST_ASSERT_TRUE(ej_print_value(value, &out));
 
-  astr = "{\"中文\":\"he don\\\"t need you. 😂\"}";
+  astr = "{\"中文\":\"he don\\\\\\\"t need you. 😂\"}";
   TEST_ASSERT_EQUAL_STRING(out, astr);
 
   g_free(out);
   ej_free_value(value);
 }
 
+static void test_parse_arena(void) {
+  gchar *str = "{ layout<key1: \"layoutvalue\", key2:[]>: { child1<@{bind:\"click\"}: \"click_handler\">: [1, 2.5, true, null] } }";
+  EJError *error = NULL;
+  EJArena *arena = ej_arena_new(256);
+  gchar *out = NULL, *aout = NULL;
+  EJValue *value = ej_parse(&error, str);
+  EJValue *avalue = ej_parse_arena(arena, &error, str);
+  EJObjectPair *pair;
+
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_NOT_NULL(avalue);
+
+  pair = (EJObjectPair *)avalue->v.object->pdata[0];
+  TEST_ASSERT_EQUAL_STRING(pair->key->v.string, "layout");
+  TEST_ASSERT_EQUAL(pair->props->len, 2);
+
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_TRUE(ej_print_value(avalue, &aout));
+  TEST_ASSERT_EQUAL_STRING(out, aout);
+
+  g_free(out);
+  g_free(aout);
+  ej_free_value(value);
+  ej_arena_free(arena);
+}
+
+static void test_parse_arena_fail(void) {
+  gchar *str = "{ name: [1, 2, { a: 1 }, \"str\" x] }";
+  EJError *error = NULL;
+  EJArena *arena = ej_arena_new(0);
+  EJValue *value = ej_parse_arena(arena, &error, str);
+
+  TEST_ASSERT_NULL(value);
+  TEST_ASSERT_NOT_NULL(error);
+  TEST_ASSERT_EQUAL_STRING(error->message, "Parse array failed");
+
+  ej_free_error(error);
+  ej_arena_free(arena);
+}
+
+static void test_parse_insitu(void) {
+  gchar *str = g_strdup("{ \"name\": \"name1\", esc: \"a\\\"b\\n\", \"\": \"\" }");
+  size_t len = strlen(str);
+  EJError *error = NULL;
+  EJObjectPair *pair;
+  EJBuffer *buffer;
+  EJString *data = NULL;
+  gchar *out = NULL;
+  EJValue *value = ej_parse_insitu(&error, str);
+
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_NOT_NULL(value);
+
+  pair = (EJObjectPair *)value->v.object->pdata[0];
+  TEST_ASSERT_TRUE(pair->key->v.string > str && pair->key->v.string < str + len);
+  TEST_ASSERT_TRUE(pair->value->v.string > str && pair->value->v.string < str + len);
+  TEST_ASSERT_EQUAL_STRING(pair->value->v.string, "name1");
+
+  pair = (EJObjectPair *)value->v.object->pdata[1];
+  TEST_ASSERT_TRUE(pair->value->flags & EJ_VALUE_FLAG_BORROWED);
+  TEST_ASSERT_EQUAL_STRING(pair->value->v.string, "a\"b\n");
+
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_EQUAL_STRING(out, "{\"name\":\"name1\",\"esc\":\"a\\\"b\\n\",\"\":\"\"}");
+
+  g_free(out);
+  ej_free_value(value);
+  g_free(str);
+
+  /* ej_parse_string has no flags to mark a borrowed string, it copies */
+  str = g_strdup("\"a\\tb\" \"c\"");
+  buffer = ej_buffer_insitu_new(str, strlen(str));
+  TEST_ASSERT_TRUE(ej_parse_string(buffer, &data));
+  TEST_ASSERT_EQUAL_STRING("a\tb", data);
+  ej_free(data);
+  ej_skip_whitespace(buffer);
+  TEST_ASSERT_TRUE(ej_parse_string(buffer, &data));
+  TEST_ASSERT_TRUE(data < str || data > str + strlen(str));
+  ej_free(data);
+  TEST_ASSERT_EQUAL_STRING("\"a\\tb\" \"c\"", str);
+  ej_free_buffer(buffer);
+  g_free(str);
+}
+
+static void test_parse_insitu_error_position(void) {
+  const gchar *str = "{ a: \"x\\ny\\nz\", b: [1 2] }";
+  gchar *writable = g_strdup(str);
+  EJError *error = NULL, *insitu_error = NULL;
+
+  TEST_ASSERT_NULL(ej_parse(&error, str));
+  TEST_ASSERT_NULL(ej_parse_insitu(&insitu_error, writable));
+  TEST_ASSERT_EQUAL(1, error->row);
+  TEST_ASSERT_EQUAL(error->row, insitu_error->row);
+  TEST_ASSERT_EQUAL(error->col, insitu_error->col);
+
+  ej_free_error(error);
+  ej_free_error(insitu_error);
+  g_free(writable);
+}
+
+static void test_parse_bytes(void) {
+  const gchar *str = "{ layout<key1: \"layoutvalue\">: [\"v\"] }";
+  GBytes *bytes = g_bytes_new(str, strlen(str));
+  EJArena *arena = ej_arena_new(0);
+  EJError *error = NULL;
+  EJObjectPair *pair;
+  EJValue *value = ej_parse_bytes(arena, &error, bytes);
+
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_NOT_NULL(value);
+
+  pair = (EJObjectPair *)value->v.object->pdata[0];
+  TEST_ASSERT_EQUAL_STRING(pair->key->v.string, "layout");
+  TEST_ASSERT_EQUAL_STRING(((EJObjectPair *)pair->props->pdata[0])->value->v.string, "layoutvalue");
+  TEST_ASSERT_EQUAL_STRING(((EJValue *)pair->value->v.array->pdata[0])->v.string, "v");
+
+  /* empty bytes have no data */
+  TEST_ASSERT_NULL(ej_parse_bytes(arena, &error, g_bytes_new(NULL, 0)));
+  TEST_ASSERT_NOT_NULL(error);
+  ej_free_error(error);
+
+  ej_arena_free(arena);
+}
+
+static void test_indented_error_position(void) {
+  GString *str = g_string_new("{\n");
+  EJError *error = NULL;
+  EJValue *value;
+
+  g_string_append_printf(str, "%40s// comment\n%33s/* block\n  comment */%20s", "", "", "");
+  g_string_append_printf(str, "key: [1,%50s\r\n%45s2 3] }", "", "");
+
+  value = ej_parse(&error, str->str);
+  TEST_ASSERT_NULL(value);
+  TEST_ASSERT_NOT_NULL(error);
+  TEST_ASSERT_EQUAL(error->row, 5);
+  TEST_ASSERT_EQUAL(error->col, 48);
+
+  ej_free_error(error);
+  g_string_free(str, true);
+}
+
+static void test_offset_to_position(void) {
+  gchar *str = "{\n  a: 1,\n\n  b: \"x\"\n}";
+  EJBuffer *buffer = ej_buffer_new(str, strlen(str));
+  size_t row = 0, col = 0;
+
+  TEST_ASSERT_TRUE(ej_offset_to_position(buffer, 0, &row, &col));
+  TEST_ASSERT_EQUAL(row, 1);
+  TEST_ASSERT_EQUAL(col, 1);
+
+  TEST_ASSERT_TRUE(ej_offset_to_position(buffer, 4, &row, &col));
+  TEST_ASSERT_EQUAL(row, 2);
+  TEST_ASSERT_EQUAL(col, 3);
+
+  TEST_ASSERT_TRUE(ej_offset_to_position(buffer, 11, &row, &col));
+  TEST_ASSERT_EQUAL(row, 4);
+  TEST_ASSERT_EQUAL(col, 1);
+
+  TEST_ASSERT_TRUE(ej_offset_to_position(buffer, strlen(str), &row, &col));
+  TEST_ASSERT_EQUAL(row, 5);
+  TEST_ASSERT_EQUAL(col, 2);
+  TEST_ASSERT_FALSE(ej_offset_to_position(buffer, strlen(str) + 1, &row, &col));
+
+  ej_free_buffer(buffer);
+}
+
+static void test_parse_empty(void) {
+  gchar *str = "  \n   ";
+  EJError *error = NULL;
+  EJValue *value = ej_parse(&error, str);
+
+  TEST_ASSERT_NULL(value);
+  TEST_ASSERT_NOT_NULL(error);
+  TEST_ASSERT_EQUAL(error->row, 2);
+  TEST_ASSERT_EQUAL(error->col, 4);
+  TEST_ASSERT_EQUAL_STRING(error->message, "Parse value failed");
+
+  ej_free_error(error);
+}
+
+static void test_parse_number(void) {
+  gchar *str = "[0, -42, 2147483648, 1e5, -0.125, 0.30000000000000004, 2.2250738585072013e-308, 12345678901234567890123]";
+  EJError *error = NULL;
+  EJArray *arr;
+  EJValue *value = ej_parse(&error, str);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_NOT_NULL(value);
+
+  arr = value->v.array;
+  TEST_ASSERT_EQUAL(((EJValue *)arr->pdata[0])->v.number->type, EJ_INT);
+  TEST_ASSERT_EQUAL(((EJValue *)arr->pdata[1])->v.number->v.i, -42);
+  TEST_ASSERT_EQUAL(((EJValue *)arr->pdata[2])->v.number->type, EJ_DOUBLE);
+  TEST_ASSERT_TRUE(((EJValue *)arr->pdata[2])->v.number->v.d == 2147483648.0);
+  TEST_ASSERT_EQUAL(((EJValue *)arr->pdata[3])->v.number->type, EJ_DOUBLE);
+  TEST_ASSERT_TRUE(((EJValue *)arr->pdata[3])->v.number->v.d == 100000.0);
+  TEST_ASSERT_TRUE(((EJValue *)arr->pdata[4])->v.number->v.d == -0.125);
+  TEST_ASSERT_TRUE(((EJValue *)arr->pdata[5])->v.number->v.d == 0.1 + 0.2);
+  TEST_ASSERT_TRUE(((EJValue *)arr->pdata[6])->v.number->v.d == 2.2250738585072013e-308);
+  TEST_ASSERT_TRUE(((EJValue *)arr->pdata[7])->v.number->v.d == 12345678901234567890123.0);
+
+  ej_free_value(value);
+}
+
+static void test_parse_number_invalid(void) {
+  gchar *strs[] = { "1-2e+", "01", "1.", "-", "1.2.3", "2.5E-" };
+  EJError *error = NULL;
+  EJValue *value;
+  size_t i;
+
+  for (i = 0; i < sizeof(strs) / sizeof(strs[0]); i++) {
+    value = ej_parse(&error, strs[i]);
+    TEST_ASSERT_NULL(value);
+    TEST_ASSERT_NOT_NULL(error);
+    TEST_ASSERT_EQUAL_STRING(error->message, "Parse number failed");
+    ej_free_error(error);
+    error = NULL;
+  }
+}
+
+static void test_object_index(void) {
+  GString *str = g_string_new("{ @{bind: \"k5\"}: 0, ");
+  EJError *error = NULL;
+  EJArena *arena = ej_arena_new(0);
+  EJValue *value, *avalue, *found = NULL;
+  EJObjectIndex *index, *aindex;
+  gchar key[16];
+  int i;
+
+  for (i = 0; i < 100; i++) {
+    g_string_append_printf(str, "k%d: %d, ", i, i);
+  }
+  g_string_append(str, "k5: -1 }");
+
+  value = ej_parse(&error, str->str);
+  avalue = ej_parse_arena(arena, &error, str->str);
+  TEST_ASSERT_NULL(error);
+  index = ej_object_index_new(value->v.object);
+  aindex = ej_object_index_new(avalue->v.object);
+  TEST_ASSERT_NOT_NULL(index);
+
+  for (i = 0; i < 100; i++) {
+    g_snprintf(key, sizeof(key), "k%d", i);
+    TEST_ASSERT_TRUE(ej_object_index_get_value(index, key, &found));
+    TEST_ASSERT_EQUAL(found->v.number->v.i, i);
+    TEST_ASSERT_TRUE(ej_object_index_get_value(aindex, key, &found));
+    TEST_ASSERT_EQUAL(found->v.number->v.i, i);
+    TEST_ASSERT_TRUE(ej_object_get_value(value->v.object, key, &found));
+    TEST_ASSERT_EQUAL(found->v.number->v.i, i);
+  }
+  TEST_ASSERT_FALSE(ej_object_index_get_value(index, "bind", &found));
+  TEST_ASSERT_FALSE(ej_object_index_get_value(index, "k100", &found));
+
+  ej_object_index_free(index);
+  ej_object_index_free(aindex);
+  g_string_free(str, true);
+  ej_free_value(value);
+  ej_arena_free(arena);
+}
+
+static void test_object_index_rebuild(void) {
+  GString *str = g_string_new("{ ");
+  EJError *error = NULL;
+  EJValue *value, *extra, *found = NULL;
+  EJObjectIndex *index;
+  int i;
+
+  for (i = 0; i < 40; i++) {
+    g_string_append_printf(str, "k%d: %d, ", i, i);
+  }
+  g_string_append(str, "}");
+  value = ej_parse(&error, str->str);
+  index = ej_object_index_new(value->v.object);
+  TEST_ASSERT_TRUE(ej_object_index_get_value(index, "k3", &found));
+
+  /* the same length and storage, the lookup without an index sees the change */
+  extra = ej_parse(&error, "{ color: 2 }");
+  g_ptr_array_remove_index(value->v.object, 3);
+  g_ptr_array_add(value->v.object, g_ptr_array_steal_index(extra->v.object, 0));
+  TEST_ASSERT_TRUE(ej_object_get_value(value->v.object, "color", &found));
+  TEST_ASSERT_EQUAL(found->v.number->v.i, 2);
+  TEST_ASSERT_FALSE(ej_object_get_value(value->v.object, "k3", &found));
+
+  /* the caller builds the index again */
+  ej_object_index_free(index);
+  index = ej_object_index_new(value->v.object);
+  TEST_ASSERT_TRUE(ej_object_index_get_value(index, "color", &found));
+  TEST_ASSERT_FALSE(ej_object_index_get_value(index, "k3", &found));
+
+  ej_object_index_free(index);
+  ej_free_value(extra);
+  ej_free_value(value);
+  g_string_free(str, true);
+}
+
+static void test_parse_key_table(void) {
+  gchar *str = "{ layout<bind: 1>: { children: [{ layout: 2 }] }, \"ch\\nild\": 3 }";
+  EJError *error = NULL;
+  EJKeyTable *keys = ej_key_table_new();
+  EJValue *value = ej_parse_keys(keys, &error, str);
+  EJValue *other = ej_parse_keys(keys, &error, "{ \"layout\": 4 }");
+  EJValue *found = NULL, *child;
+  EJObjectPair *pair, *opair;
+  EJBuffer *buffer;
+  EJString *data = NULL;
+  const EJString *layout = ej_key_table_intern(keys, "layout");
+
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_NOT_NULL(value);
+  TEST_ASSERT_NOT_NULL(other);
+
+  pair = (EJObjectPair *)value->v.object->pdata[0];
+  opair = (EJObjectPair *)other->v.object->pdata[0];
+  TEST_ASSERT_EQUAL_PTR(pair->key->v.string, layout);
+  TEST_ASSERT_EQUAL_PTR(opair->key->v.string, layout);
+  TEST_ASSERT_TRUE(pair->key->flags & EJ_VALUE_FLAG_INTERNED);
+
+  child = ((EJObjectPair *)pair->value->v.object->pdata[0])->value;
+  TEST_ASSERT_EQUAL_PTR(((EJObjectPair *)((EJValue *)child->v.array->pdata[0])->v.object->pdata[0])->key->v.string, layout);
+
+  TEST_ASSERT_TRUE(ej_object_get_interned(value->v.object, layout, &found));
+  TEST_ASSERT_EQUAL(found->type, EJ_OBJECT);
+  TEST_ASSERT_TRUE(ej_object_get_interned(value->v.object, ej_key_table_intern(keys, "ch\nild"), &found));
+  TEST_ASSERT_EQUAL(found->v.number->v.i, 3);
+  TEST_ASSERT_TRUE(ej_object_get_value(other->v.object, "layout", &found));
+  TEST_ASSERT_EQUAL(found->v.number->v.i, 4);
+
+  /* the public key parser returns a key the caller owns, never the table's */
+  buffer = ej_buffer_new("layout: 1", 9);
+  ej_buffer_set_key_table(buffer, keys);
+  TEST_ASSERT_TRUE(ej_parse_key_without_quote(buffer, &data));
+  TEST_ASSERT_EQUAL_STRING("layout", data);
+  TEST_ASSERT_TRUE(data != layout);
+  ej_free(data);
+  ej_free_buffer(buffer);
+
+  ej_free_value(value);
+  ej_free_value(other);
+  ej_key_table_free(keys);
+}
+
+static void test_parse_iterative(void) {
+  gchar *str = "{ layout<key1: \"layoutvalue\", key2:[]>: { child1<@{bind:\"click\"}: \"click_handler\">: [1, 2.5, true, null] }, @{a: 1}: [] }";
+  EJError *error = NULL;
+  gchar *out = NULL, *iout = NULL;
+  EJValue *value = ej_parse(&error, str);
+  EJValue *ivalue = ej_parse_iterative(0, &error, str);
+
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_NOT_NULL(ivalue);
+
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_TRUE(ej_print_value(ivalue, &iout));
+  TEST_ASSERT_EQUAL_STRING(out, iout);
+
+  g_free(out);
+  g_free(iout);
+  ej_free_value(value);
+  ej_free_value(ivalue);
+}
+
+static void test_parse_iterative_depth(void) {
+  size_t i, depth = 200000;
+  GString *str = g_string_sized_new(depth * 6);
+  EJError *error = NULL;
+  EJValue *value;
+
+  for (i = 0; i < depth; i++) {
+    g_string_append(str, i % 2 ? "[" : "{a<b:1>:");
+  }
+  g_string_append(str, "0");
+  for (i = depth; i > 0; i--) {
+    g_string_append(str, (i - 1) % 2 ? "]" : "}");
+  }
+
+  value = ej_parse_iterative(0, &error, str->str);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_NOT_NULL(value);
+  ej_free_value(value);
+
+  value = ej_parse_iterative(64, &error, str->str);
+  TEST_ASSERT_NULL(value);
+  TEST_ASSERT_NOT_NULL(error);
+  TEST_ASSERT_EQUAL_STRING(error->message, "Exceed max depth 64");
+
+  ej_free_error(error);
+  g_string_free(str, true);
+}
+
+typedef struct {
+  GString *out;
+  size_t stop;
+} TestEvents;
+
+static EJBool test_event(TestEvents *events, const gchar *name) {
+  g_string_append(events->out, name);
+  return events->out->len < events->stop;
+}
+static EJBool test_begin_object(gpointer u) { return test_event(u, "{"); }
+static EJBool test_end_object(gpointer u) { return test_event(u, "}"); }
+static EJBool test_begin_array(gpointer u) { return test_event(u, "["); }
+static EJBool test_end_array(gpointer u) { return test_event(u, "]"); }
+static EJBool test_begin_props(gpointer u) { return test_event(u, "<"); }
+static EJBool test_end_props(gpointer u) { return test_event(u, ">"); }
+static EJBool test_eobject(gpointer u) { return test_event(u, "@"); }
+static EJBool test_null(gpointer u) { return test_event(u, "n"); }
+static EJBool test_boolean(EJBool data, gpointer u) { return test_event(u, data ? "t" : "f"); }
+static EJBool test_number(const EJNumber *data, gpointer u) { return test_event(u, data->type == EJ_INT ? "i" : "d"); }
+static EJBool test_key(const EJString *data, size_t len, gpointer u) {
+  g_string_append_len(((TestEvents *)u)->out, data, len);
+  return test_event(u, "=");
+}
+static EJBool test_string(const EJString *data, size_t len, gpointer u) {
+  g_string_append_c(((TestEvents *)u)->out, '\'');
+  g_string_append_len(((TestEvents *)u)->out, data, len);
+  return test_event(u, "'");
+}
+
+static void test_parse_events(void) {
+  gchar *str = "{ layout<key1: \"a\\tb\", key2:[]>: { child1<@{bind:\"click\"}: null>: [1, 2.5, true] }, \"@\": @{} }";
+  EJHandler handler = {
+    test_begin_object, test_end_object, test_begin_array, test_end_array,
+    test_begin_props, test_end_props, test_eobject, test_key,
+    test_string, test_number, test_boolean, test_null
+  };
+  TestEvents events = { g_string_new(""), G_MAXINT };
+  EJError *error = NULL;
+
+  TEST_ASSERT_TRUE(ej_parse_events(&handler, &events, &error, str));
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_EQUAL_STRING(events.out->str, "{layout=<key1='a\tb'key2=[]>{child1=<@{bind='click'}n>[idt]}@=@{}}");
+
+  g_string_truncate(events.out, 0);
+  events.stop = 8;
+  TEST_ASSERT_FALSE(ej_parse_events(&handler, &events, &error, str));
+  TEST_ASSERT_NOT_NULL(error);
+  TEST_ASSERT_EQUAL_STRING(error->message, "Stopped by handler");
+  TEST_ASSERT_EQUAL(error->col, 9);
+
+  ej_free_error(error);
+  g_string_free(events.out, true);
+}
+
+static EJValue *test_push_chunks(const gchar *str, size_t chunk, EJError **error) {
+  EJPushParser *parser = ej_push_parser_new();
+  size_t pos, len = strlen(str);
+  EJValue *value;
+
+  for (pos = 0; pos < len; pos += chunk) {
+    ej_push_feed(parser, str + pos, MIN(chunk, len - pos));
+  }
+  value = ej_push_finish(parser, error);
+  ej_push_parser_free(parser);
+
+  return value;
+}
+
+static void test_push_parser(void) {
+  gchar *str = "{ layout<key1: \"layout\\\"value\", key2:[]>: { // line\n child1<@{bind:\"click\"}: \"click_handler\">: [12345, -2.5e3, true, null] }, /* block */ @{a: 1}: [] }";
+  EJError *error = NULL;
+  gchar *out = NULL, *pout = NULL;
+  EJValue *value = ej_parse(&error, str);
+  EJValue *pvalue;
+  size_t chunk;
+
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  for (chunk = 1; chunk < 8; chunk++) {
+    pvalue = test_push_chunks(str, chunk, &error);
+    TEST_ASSERT_NULL(error);
+    TEST_ASSERT_NOT_NULL(pvalue);
+
+    TEST_ASSERT_TRUE(ej_print_value(pvalue, &pout));
+    TEST_ASSERT_EQUAL_STRING(out, pout);
+    g_free(pout);
+    pout = NULL;
+    ej_free_value(pvalue);
+  }
+
+  g_free(out);
+  ej_free_value(value);
+}
+
+static void test_push_parser_error(void) {
+  gchar *str = "{\n  a: [1, 2],\n  b: {c: \"d\"},\n  e: [3, x]\n}";
+  EJError *error = NULL, *perror = NULL, *error2 = NULL;
+  EJPushParser *parser;
+
+  TEST_ASSERT_NULL(ej_parse(&error, str));
+  TEST_ASSERT_NULL(test_push_chunks(str, 3, &perror));
+  TEST_ASSERT_NOT_NULL(perror);
+  TEST_ASSERT_EQUAL_STRING(error->message, perror->message);
+  TEST_ASSERT_EQUAL(error->row, perror->row);
+  TEST_ASSERT_EQUAL(error->col, perror->col);
+  TEST_ASSERT_EQUAL(perror->row, 4);
+
+  /* the partial tree of an unfinished parse is freed */
+  parser = ej_push_parser_new();
+  TEST_ASSERT_TRUE(ej_push_feed(parser, str, 20));
+  ej_push_parser_free(parser);
+
+  /* the terminator ends the content before the first byte, as in ej_parse */
+  parser = ej_push_parser_new();
+  TEST_ASSERT_TRUE(ej_push_feed(parser, "\0{}", 3));
+  TEST_ASSERT_NULL(ej_push_finish(parser, &error2));
+  TEST_ASSERT_NOT_NULL(error2);
+  ej_free_error(error2);
+  ej_push_parser_free(parser);
+
+  ej_free_error(error);
+  ej_free_error(perror);
+}
+
+static void test_parse_len(void) {
+  gchar *str = "{a: \"b\", c: [1, 2]}{a: 1}";
+  EJError *error = NULL;
+  gchar *out = NULL;
+  EJValue *value = ej_parse_len(&error, str + 19, 6);
+
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_EQUAL_STRING(out, "{\"a\":1}");
+  g_free(out);
+  ej_free_value(value);
+
+  /* the content stops in the middle of the array */
+  TEST_ASSERT_NULL(ej_parse_len(&error, str, 17));
+  TEST_ASSERT_NOT_NULL(error);
+  ej_free_error(error);
+}
+
+static void test_parse_file(void) {
+  gchar *str = "{ layout<key1: \"layout\\\"value\">: { child1: [1, \"two\", @{bind: \"click\"}] } }";
+  gchar *path = g_build_filename(g_get_tmp_dir(), "ExtendJson-test.json", NULL);
+  EJArena *arena = ej_arena_new(0);
+  EJError *error = NULL;
+  gchar *out = NULL, *fout = NULL;
+  EJValue *value = ej_parse(&error, str);
+  EJValue *fvalue;
+
+  TEST_ASSERT_TRUE(g_file_set_contents(path, str, -1, NULL));
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+
+  fvalue = ej_parse_file(NULL, &error, path);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_TRUE(ej_print_value(fvalue, &fout));
+  TEST_ASSERT_EQUAL_STRING(out, fout);
+  g_free(fout);
+  fout = NULL;
+  ej_free_value(fvalue);
+
+  /* in situ, the strings point into the mapping the arena keeps */
+  fvalue = ej_parse_file(arena, &error, path);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_TRUE(ej_print_value(fvalue, &fout));
+  TEST_ASSERT_EQUAL_STRING(out, fout);
+  g_free(fout);
+  ej_arena_free(arena);
+
+  /* the writable mapping must not need write access to the file */
+  TEST_ASSERT_EQUAL_INT(0, g_chmod(path, 0444));
+  arena = ej_arena_new(0);
+  fvalue = ej_parse_file(arena, &error, path);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_TRUE(ej_print_value(fvalue, &fout));
+  TEST_ASSERT_EQUAL_STRING(out, fout);
+  g_free(fout);
+  ej_arena_free(arena);
+  TEST_ASSERT_EQUAL_INT(0, g_chmod(path, 0644));
+
+  TEST_ASSERT_TRUE(g_file_set_contents(path, "", 0, NULL));
+  TEST_ASSERT_NULL(ej_parse_file(NULL, &error, path));
+  TEST_ASSERT_NOT_NULL(error);
+  ej_free_error(error);
+  error = NULL;
+
+  g_unlink(path);
+  TEST_ASSERT_NULL(ej_parse_file(NULL, &error, path));
+  TEST_ASSERT_NOT_NULL(error);
+  TEST_ASSERT_NOT_NULL(error->message);
+
+  ej_free_error(error);
+  ej_free_value(value);
+  g_free(out);
+  g_free(path);
+}
+
+static void test_cursor(void) {
+  gchar *str = "{ skip: [\"]}\", /* ] */ {a: \"\\\"}\"}], layout<key1: \"a\\tb\", @{bind: \"click\"}: 7>: { child1: [1, 2.5, true] }, empty: [] }";
+  EJBuffer *buffer = ej_buffer_new(str, strlen(str));
+  EJCursor root, layout, it, key;
+  EJKeyTable *keys;
+  EJValue *value = NULL, *expected;
+  EJString *data = NULL;
+  EJNumber number;
+  EJBool b = false;
+  EJError *error = NULL;
+  gchar *out = NULL, *eout = NULL;
+
+  TEST_ASSERT_TRUE(ej_cursor_init(&root, buffer));
+  TEST_ASSERT_EQUAL(EJ_OBJECT, ej_cursor_type(&root));
+
+  /* skip is passed over without being decoded */
+  TEST_ASSERT_TRUE(ej_cursor_find_key(&root, "layout", &layout));
+  TEST_ASSERT_EQUAL(EJ_OBJECT, ej_cursor_type(&layout));
+
+  TEST_ASSERT_TRUE(ej_cursor_find_prop(&layout, "key1", &it));
+  TEST_ASSERT_TRUE(ej_cursor_get_string(&it, &data));
+  TEST_ASSERT_EQUAL_STRING("a\tb", data);
+  ej_free(data);
+
+  /* the second prop has an @ key */
+  TEST_ASSERT_TRUE(ej_cursor_next(&it));
+  TEST_ASSERT_TRUE(ej_cursor_key(&it, &key));
+  TEST_ASSERT_EQUAL(EJ_EOBJECT, ej_cursor_type(&key));
+  TEST_ASSERT_TRUE(ej_cursor_get_number(&it, &number));
+  TEST_ASSERT_EQUAL(7, number.v.i);
+  TEST_ASSERT_FALSE(ej_cursor_next(&it));
+
+  TEST_ASSERT_TRUE(ej_cursor_find_key(&layout, "child1", &it));
+  TEST_ASSERT_TRUE(ej_cursor_enter(&it, &it));
+  TEST_ASSERT_TRUE(ej_cursor_next(&it));
+  TEST_ASSERT_TRUE(ej_cursor_get_number(&it, &number));
+  TEST_ASSERT_EQUAL(EJ_DOUBLE, number.type);
+  TEST_ASSERT_TRUE(ej_cursor_next(&it));
+  TEST_ASSERT_TRUE(ej_cursor_get_bool(&it, &b));
+  TEST_ASSERT_TRUE(b);
+  TEST_ASSERT_FALSE(ej_cursor_next(&it));
+
+  /* no such child is not an error */
+  TEST_ASSERT_TRUE(ej_cursor_find_key(&root, "empty", &it));
+  TEST_ASSERT_FALSE(ej_cursor_enter(&it, &it));
+  TEST_ASSERT_FALSE(ej_cursor_find_key(&root, "missing", &it));
+  TEST_ASSERT_NULL(ej_get_error(buffer)->message);
+
+  TEST_ASSERT_TRUE(ej_cursor_get_value(&root, &value));
+  expected = ej_parse(&error, str);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_TRUE(ej_print_value(expected, &eout));
+  TEST_ASSERT_EQUAL_STRING(eout, out);
+
+  g_free(out);
+  g_free(eout);
+  ej_free_value(value);
+  ej_free_value(expected);
+  ej_free_buffer(buffer);
+
+  /* with a key table, the strings are still the caller's to free */
+  keys = ej_key_table_new();
+  buffer = ej_buffer_new(str, strlen(str));
+  ej_buffer_set_key_table(buffer, keys);
+  TEST_ASSERT_TRUE(ej_cursor_init(&root, buffer));
+  TEST_ASSERT_TRUE(ej_cursor_find_key(&root, "layout", &layout));
+  TEST_ASSERT_TRUE(ej_cursor_key(&layout, &key));
+  TEST_ASSERT_TRUE(ej_cursor_get_string(&key, &data));
+  TEST_ASSERT_EQUAL_STRING("layout", data);
+  ej_free(data);
+  TEST_ASSERT_TRUE(ej_cursor_find_prop(&layout, "key1", &it));
+  TEST_ASSERT_TRUE(ej_cursor_key(&it, &key));
+  TEST_ASSERT_TRUE(ej_cursor_get_string(&key, &data));
+  TEST_ASSERT_EQUAL_STRING("key1", data);
+  ej_free(data);
+  ej_free_buffer(buffer);
+  ej_key_table_free(keys);
+}
+
+static void test_parse_indexed(void) {
+  gchar *strs[] = {
+    /* longer than a block, with comments and escaped quotes */
+    "{ layout<key1: \"layout\\\"value\", key2:[]>: { /* \"} */ child1<@{bind:\"click\"}: \"click_handler\">: [1, 2.5e3, true, null, \"a\\\\\"] },\n"
+    "  // [\n  @{a: 1}: [], text: \"a long string which does not fit into one block of the index\", e: @ {} }",
+    /* a '@' key which falls back to a bare key */
+    "{ @x: 1 }",
+    "{ a: [1, 2,, 3] }",
+    "{ a<b: 1 >: 2 }",
+  };
+  EJError *error = NULL, *ierror = NULL;
+  gchar *out = NULL, *iout = NULL;
+  EJValue *value, *ivalue;
+  size_t i;
+
+  for (i = 0; i < G_N_ELEMENTS(strs); i++) {
+    value = ej_parse(&error, strs[i]);
+    ivalue = ej_parse_indexed(&ierror, strs[i]);
+
+    if (value == NULL) {
+      /* the same error, the recursive parser reports it */
+      TEST_ASSERT_NULL(ivalue);
+      TEST_ASSERT_EQUAL_STRING(error->message, ierror->message);
+      TEST_ASSERT_EQUAL(error->row, ierror->row);
+      TEST_ASSERT_EQUAL(error->col, ierror->col);
+      ej_free_error(error);
+      ej_free_error(ierror);
+      error = ierror = NULL;
+      continue;
+    }
+
+    TEST_ASSERT_NULL(ierror);
+    TEST_ASSERT_TRUE(ej_print_value(value, &out));
+    TEST_ASSERT_TRUE(ej_print_value(ivalue, &iout));
+    TEST_ASSERT_EQUAL_STRING(out, iout);
+
+    g_free(out);
+    g_free(iout);
+    out = iout = NULL;
+    ej_free_value(value);
+    ej_free_value(ivalue);
+  }
+}
+
+static void test_document(void) {
+  gchar *str = "{ layout<key1: \"a\\tb\", @{bind: \"click\"}: 7, e<>: 1>: { child1: [1, 2.5, true, null] }, @{x: 1}: @{y: []}, empty: [] }";
+  EJDocument *doc;
+  EJTape root, layout, it, key;
+  EJValue *value, *expected;
+  EJError *error = NULL;
+  EJNumber number;
+  EJBool b = false;
+  gchar *out = NULL, *eout = NULL;
+  size_t len = 0;
+
+  doc = ej_parse_document(&error, str);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_NOT_NULL(doc);
+  TEST_ASSERT_TRUE(ej_document_root(doc, &root));
+  TEST_ASSERT_EQUAL(EJ_OBJECT, ej_tape_type(&root));
+  TEST_ASSERT_EQUAL(3, ej_tape_count(&root));
+
+  TEST_ASSERT_TRUE(ej_tape_find_key(&root, "layout", &layout));
+  TEST_ASSERT_TRUE(ej_tape_find_prop(&layout, "key1", &it));
+  TEST_ASSERT_EQUAL_STRING("a\tb", ej_tape_get_string(&it, &len));
+  TEST_ASSERT_EQUAL(3, len);
+
+  TEST_ASSERT_TRUE(ej_tape_next(&it));
+  TEST_ASSERT_TRUE(ej_tape_key(&it, &key));
+  TEST_ASSERT_EQUAL(EJ_EOBJECT, ej_tape_type(&key));
+  TEST_ASSERT_TRUE(ej_tape_get_number(&it, &number));
+  TEST_ASSERT_EQUAL(7, number.v.i);
+
+  TEST_ASSERT_TRUE(ej_tape_find_key(&layout, "child1", &it));
+  TEST_ASSERT_EQUAL(4, ej_tape_count(&it));
+  TEST_ASSERT_TRUE(ej_tape_enter(&it, &it));
+  TEST_ASSERT_TRUE(ej_tape_next(&it));
+  TEST_ASSERT_TRUE(ej_tape_get_number(&it, &number));
+  TEST_ASSERT_EQUAL(EJ_DOUBLE, number.type);
+  TEST_ASSERT_TRUE(ej_tape_next(&it));
+  TEST_ASSERT_TRUE(ej_tape_get_bool(&it, &b));
+  TEST_ASSERT_TRUE(b);
+  TEST_ASSERT_TRUE(ej_tape_next(&it));
+  TEST_ASSERT_EQUAL(EJ_NULL, ej_tape_type(&it));
+  TEST_ASSERT_FALSE(ej_tape_next(&it));
+
+  TEST_ASSERT_TRUE(ej_tape_find_key(&root, "empty", &it));
+  TEST_ASSERT_FALSE(ej_tape_enter(&it, &it));
+  TEST_ASSERT_FALSE(ej_tape_find_key(&root, "missing", &it));
+
+  value = ej_tape_to_value(&root);
+  expected = ej_parse(&error, str);
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_TRUE(ej_print_value(expected, &eout));
+  TEST_ASSERT_EQUAL_STRING(eout, out);
+
+  g_free(out);
+  g_free(eout);
+  ej_free_value(value);
+  ej_free_value(expected);
+  ej_document_free(doc);
+
+  TEST_ASSERT_NULL(ej_parse_document(&error, "{ a: [1, 2,, 3] }"));
+  TEST_ASSERT_NOT_NULL(error);
+  ej_free_error(error);
+}
+
+static void test_parse_parallel(void) {
+  GString *array = g_string_new("[\n"), *object = g_string_new("{\n");
+  gchar *strs[3];
+  EJError *error = NULL, *perror = NULL;
+  gchar *out = NULL, *pout = NULL;
+  EJValue *value, *pvalue;
+  size_t i;
+
+  /* large enough to be split, the error is in a later chunk */
+  for (i = 0; i < 20000; i++) {
+    g_string_append_printf(array, "  { id: %u, name<k: \"v,]\">: \"n\\\"%u\" }, // ,\n", (guint)i, (guint)i);
+    g_string_append_printf(object, "  k%u: [%u, /* , */ \"}\"],\n", (guint)i, (guint)i);
+  }
+  g_string_append(array, "]");
+  g_string_append(object, "}");
+  strs[0] = array->str;
+  strs[1] = object->str;
+  strs[2] = g_strdup(array->str);
+  strs[2][array->len * 3 / 4] = '@';
+
+  for (i = 0; i < G_N_ELEMENTS(strs); i++) {
+    value = ej_parse(&error, strs[i]);
+    pvalue = ej_parse_parallel(4, &perror, strs[i]);
+
+    if (value == NULL) {
+      TEST_ASSERT_NULL(pvalue);
+      TEST_ASSERT_EQUAL_STRING(error->message, perror->message);
+      TEST_ASSERT_EQUAL(error->row, perror->row);
+      TEST_ASSERT_EQUAL(error->col, perror->col);
+      ej_free_error(error);
+      ej_free_error(perror);
+      error = perror = NULL;
+      continue;
+    }
+
+    TEST_ASSERT_NULL(perror);
+    TEST_ASSERT_TRUE(ej_print_value(value, &out));
+    TEST_ASSERT_TRUE(ej_print_value(pvalue, &pout));
+    TEST_ASSERT_EQUAL_STRING(out, pout);
+
+    g_free(out);
+    g_free(pout);
+    out = pout = NULL;
+    ej_free_value(value);
+    ej_free_value(pvalue);
+  }
+
+  g_free(strs[2]);
+  g_string_free(array, true);
+  g_string_free(object, true);
+}
+
+static void test_parse_options(void) {
+  const gchar *json = "{\"a\": [1, true, null], \"b\": {\"c\": \"d\"}}";
+  const gchar *rejected[] = {
+    "[1, /* c */ 2]", "[1, 2,]", "{\"a\": 1,}", "{a: 1}", "{\"a\"<k: 1>: 2}", "[@{\"a\": 1}]", "{@{\"a\": 1}: 2}"
+  };
+  /* the option each one needs */
+  const EJParseOptions needs[] = {
+    EJ_PARSE_COMMENTS, EJ_PARSE_TRAILING_COMMAS, EJ_PARSE_TRAILING_COMMAS, EJ_PARSE_BARE_KEYS,
+    EJ_PARSE_BARE_KEYS | EJ_PARSE_PROPS, EJ_PARSE_EOBJECTS, EJ_PARSE_EOBJECTS
+  };
+  GString *array = g_string_new("[\n");
+  EJError *error = NULL;
+  EJBuffer *buffer;
+  EJValue *value;
+  gchar *out = NULL;
+  size_t i;
+
+  value = ej_parse_options(EJ_PARSE_STRICT, &error, json);
+  TEST_ASSERT_NOT_NULL(value);
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_EQUAL_STRING("{\"a\":[1,true,null],\"b\":{\"c\":\"d\"}}", out);
+  g_free(out);
+  out = NULL;
+  ej_free_value(value);
+
+  for (i = 0; i < G_N_ELEMENTS(rejected); i++) {
+    value = ej_parse_options(EJ_PARSE_STRICT, &error, rejected[i]);
+    TEST_ASSERT_NULL(value);
+    TEST_ASSERT_NOT_NULL(error);
+    ej_free_error(error);
+    error = NULL;
+
+    value = ej_parse_options(EJ_PARSE_EXTENDED & ~needs[i], &error, rejected[i]);
+    TEST_ASSERT_NULL(value);
+    ej_free_error(error);
+    error = NULL;
+
+    value = ej_parse_options(needs[i], &error, rejected[i]);
+    TEST_ASSERT_NOT_NULL(value);
+    TEST_ASSERT_NULL(error);
+    ej_free_value(value);
+  }
+
+  value = ej_parse_options(EJ_PARSE_STRICT, &error, "[1, 2,]");
+  TEST_ASSERT_EQUAL_STRING("Trailing comma is not allowed", error->message);
+  ej_free_error(error);
+  error = NULL;
+
+  /* the workers of a parallel parse keep the dialect */
+  for (i = 0; i < 20000; i++) {
+    g_string_append_printf(array, "  {\"id\": %u},\n", (guint)i);
+  }
+  g_string_append(array, "  {}\n]");
+  buffer = ej_buffer_mode_new(array->str, array->len, EJ_MODE_PARALLEL);
+  ej_buffer_set_threads(buffer, 4);
+  ej_buffer_set_options(buffer, EJ_PARSE_STRICT);
+  TEST_ASSERT_TRUE(ej_parse_value(buffer, &value));
+  TEST_ASSERT_EQUAL(20001, value->v.array->len);
+  ej_free_value(value);
+  ej_free_buffer(buffer);
+
+  /* a comment in a later chunk */
+  g_string_insert(array, array->len * 3 / 4, "//");
+  buffer = ej_buffer_mode_new(array->str, array->len, EJ_MODE_PARALLEL);
+  ej_buffer_set_threads(buffer, 4);
+  ej_buffer_set_options(buffer, EJ_PARSE_STRICT);
+  TEST_ASSERT_FALSE(ej_parse_value(buffer, &value));
+  error = ej_get_error(buffer);
+  TEST_ASSERT_NOT_NULL(error->message);
+  ej_free_buffer(buffer);
+  ej_free_error(error);
+
+  g_string_free(array, true);
+}
+
+static EJBool test_parse_many_stop(size_t index, EJValue *value, EJError *error, gpointer user_data) {
+  ej_free_value(value);
+  *(size_t *)user_data = index;
+  return index < 1;
+}
+
+static void test_parse_many(void) {
+  gchar *str = "{a: 1}\n[1, 2]\n{ b: [1,, 2] }\n  \"str\" /* c */ {c<d: 1>: @{e: 2}}\n";
+  gchar *docs[] = { "{a: 1}", "[1, 2]", NULL, "\"str\"", "{c<d: 1>: @{e: 2}}" };
+  GString *lines = g_string_new(NULL);
+  EJManyResult *results;
+  EJError *error = NULL;
+  EJValue *expected;
+  gchar *out = NULL, *eout = NULL;
+  size_t n = 0, i, last = 0;
+  EJNumber *number;
+
+  results = ej_parse_many(str, strlen(str), 2, &n);
+  TEST_ASSERT_EQUAL(5, n);
+  for (i = 0; i < n; i++) {
+    if (docs[i] == NULL) {
+      TEST_ASSERT_NULL(results[i].value);
+      TEST_ASSERT_NOT_NULL(results[i].error);
+      TEST_ASSERT_EQUAL(3, results[i].error->row);
+      continue;
+    }
+
+    TEST_ASSERT_NULL(results[i].error);
+    expected = ej_parse(&error, docs[i]);
+    TEST_ASSERT_TRUE(ej_print_value(results[i].value, &out));
+    TEST_ASSERT_TRUE(ej_print_value(expected, &eout));
+    TEST_ASSERT_EQUAL_STRING(eout, out);
+    g_free(out);
+    g_free(eout);
+    out = eout = NULL;
+    ej_free_value(expected);
+  }
+  ej_free_many(results, n);
+
+  /* a comment left open after the last document */
+  results = ej_parse_many("[1] /* c", 8, 1, &n);
+  TEST_ASSERT_EQUAL(1, n);
+  TEST_ASSERT_NULL(results[0].error);
+  ej_free_many(results, n);
+
+  /* more batches than the workers take at once, still in order */
+  for (i = 0; i < 10000; i++) {
+    g_string_append_printf(lines, "{ id: %u, tags: [\"a\", \"b\"] }\n", (guint)i);
+  }
+  results = ej_parse_many(lines->str, lines->len, 4, &n);
+  TEST_ASSERT_EQUAL(10000, n);
+  for (i = 0; i < n; i++) {
+    number = ((EJObjectPair *)g_ptr_array_index(results[i].value->v.object, 0))->value->v.number;
+    TEST_ASSERT_EQUAL(i, number->v.i);
+  }
+  ej_free_many(results, n);
+
+  TEST_ASSERT_EQUAL(2, ej_parse_many_foreach(lines->str, lines->len, 4, test_parse_many_stop, &last));
+  TEST_ASSERT_EQUAL(1, last);
+  g_string_free(lines, true);
+}
+
+static void test_unicode(void) {
+  const gchar *invalid[] = { "\"\\ud800\"", "\"\\udc00\"", "\"\\ud800\\u0041\"", "\"\\u12g4\"", "\"\\u0000\"" };
+  const gchar *bytes = "[\"caf\xc3\xa9\", \"\xe2\x82\xac\", \"\xf0\x9f\x98\x80\"]";
+  GString *long_string = g_string_new("[\"");
+  EJError *error = NULL;
+  EJBuffer *buffer;
+  EJValue *value;
+  size_t i, offset;
+
+  value = ej_parse(&error, "[\"\\u0041\\u00e9\\u20ac\", \"\\ud83d\\ude00\"]");
+  TEST_ASSERT_NOT_NULL(value);
+  TEST_ASSERT_EQUAL_STRING("A\xc3\xa9\xe2\x82\xac", ((EJValue *)value->v.array->pdata[0])->v.string);
+  TEST_ASSERT_EQUAL_STRING("\xf0\x9f\x98\x80", ((EJValue *)value->v.array->pdata[1])->v.string);
+  ej_free_value(value);
+
+  for (i = 0; i < G_N_ELEMENTS(invalid); i++) {
+    value = ej_parse(&error, invalid[i]);
+    TEST_ASSERT_NULL(value);
+    TEST_ASSERT_NOT_NULL(error);
+    ej_free_error(error);
+    error = NULL;
+  }
+
+  TEST_ASSERT_TRUE(ej_validate_utf8(bytes, strlen(bytes), &offset));
+  TEST_ASSERT_FALSE(ej_validate_utf8("ab\xc0\x80", 4, &offset));
+  TEST_ASSERT_EQUAL(2, offset);
+  TEST_ASSERT_FALSE(ej_validate_utf8("ab\xed\xa0\x80", 5, &offset));
+  TEST_ASSERT_EQUAL(2, offset);
+  TEST_ASSERT_FALSE(ej_validate_utf8("ab\xf0\x9f\x98", 5, &offset));
+  TEST_ASSERT_EQUAL(2, offset);
+
+  /* past the vector blocks */
+  for (i = 0; i < 100; i++) {
+    g_string_append(long_string, "\xe6\x97\xa5\xe6\x9c\xac abc ");
+  }
+  g_string_append(long_string, "\"]");
+  TEST_ASSERT_TRUE(ej_validate_utf8(long_string->str, long_string->len, &offset));
+  long_string->str[long_string->len - 40] = '\xff';
+  TEST_ASSERT_FALSE(ej_validate_utf8(long_string->str, long_string->len, &offset));
+  TEST_ASSERT_EQUAL(long_string->len - 40, offset);
+
+  buffer = ej_buffer_new(long_string->str, long_string->len);
+  ej_buffer_set_validate_utf8(buffer, true);
+  TEST_ASSERT_FALSE(ej_parse_value(buffer, &value));
+  error = ej_get_error(buffer);
+  TEST_ASSERT_EQUAL_STRING("Invalid UTF-8", error->message);
+  ej_free_buffer(buffer);
+  ej_free_error(error);
+
+  buffer = ej_buffer_new(bytes, strlen(bytes));
+  ej_buffer_set_validate_utf8(buffer, true);
+  TEST_ASSERT_TRUE(ej_parse_value(buffer, &value));
+  TEST_ASSERT_EQUAL(3, value->v.array->len);
+  ej_free_value(value);
+  ej_free_buffer(buffer);
+
+  g_string_free(long_string, true);
+}
+
+static void test_print_escape(void) {
+  GString *raw = g_string_new("");
+  EJValue *value, *again;
+  EJObjectPair *pair;
+  EJError *error = NULL;
+  gchar *out = NULL, *out2 = NULL;
+  guint i;
+
+  value = ej_parse(&error, "{\"a\\\"b\": \"x\\ny\\t\\\\z\\u0001\"}");
+  TEST_ASSERT_NOT_NULL(value);
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_EQUAL_STRING("{\"a\\\"b\":\"x\\ny\\t\\\\z\\u0001\"}", out);
+  g_free(out);
+  out = NULL;
+  ej_free_value(value);
+
+  /* every control character, at every offset of the vector blocks */
+  for (i = 1; i < 0x80; i++) {
+    g_string_append(raw, "abcdefghijklmnopqrstuvwxyz \xc3\xa9");
+    g_string_append_c(raw, (gchar)i);
+  }
+  value = ej_parse(&error, "{key: [\"\"]}");
+  pair = value->v.object->pdata[0];
+  g_free(pair->key->v.string);
+  pair->key->v.string = g_strdup(raw->str);
+  again = ((EJValue *)pair->value->v.array->pdata[0]);
+  g_free(again->v.string);
+  again->v.string = g_strdup(raw->str);
+
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  again = ej_parse(&error, out);
+  TEST_ASSERT_NOT_NULL(again);
+  pair = again->v.object->pdata[0];
+  TEST_ASSERT_EQUAL_STRING(raw->str, pair->key->v.string);
+  TEST_ASSERT_EQUAL_STRING(raw->str, ((EJValue *)pair->value->v.array->pdata[0])->v.string);
+  TEST_ASSERT_TRUE(ej_print_value(again, &out2));
+  TEST_ASSERT_EQUAL_STRING(out, out2);
+
+  g_free(out);
+  g_free(out2);
+  ej_free_value(value);
+  ej_free_value(again);
+  g_string_free(raw, true);
+}
+
+static void test_write_value(void) {
+  const gchar *json = "{layout<key1: \"v\\\"1\", key2: [1, 2.5, null]>: {child1<@{bind: \"click\"}: \"h\\n\">: @{bind: true}}, list: []}";
+  GString *big = g_string_new("{");
+  GString *out;
+  EJValue *value;
+  EJError *error = NULL;
+  gchar *str = NULL;
+  guint i;
+
+  value = ej_parse(&error, json);
+  TEST_ASSERT_NOT_NULL(value);
+  TEST_ASSERT_TRUE(ej_print_value(value, &str));
+
+  /* appends after what is already there */
+  out = g_string_sized_new(ej_write_value_size(value) + 1);
+  g_string_append(out, "> ");
+  TEST_ASSERT_TRUE(ej_write_value(value, out));
+  TEST_ASSERT_EQUAL(ej_write_value_size(value), out->len - 2);
+  TEST_ASSERT_EQUAL_STRING(str, out->str + 2);
+  TEST_ASSERT_EQUAL_STRING("{\"layout\"<\"key1\":\"v\\\"1\",\"key2\":[1,2.5,null]>:{\"child1\"<@{\"bind\":\"click\"}:\"h\\n\">:@{\"bind\":true}},\"list\":[]}", str);
+  g_free(str);
+  g_string_free(out, true);
+  ej_free_value(value);
+
+  /* a large object is written in one pass */
+  for (i = 0; i < 50000; i++) {
+    g_string_append_printf(big, "%s\"k%u\":%u", i > 0 ? "," : "", i, i);
+  }
+  g_string_append(big, "}");
+  value = ej_parse(&error, big->str);
+  TEST_ASSERT_NOT_NULL(value);
+  out = g_string_new("");
+  TEST_ASSERT_TRUE(ej_write_value(value, out));
+  TEST_ASSERT_EQUAL_STRING(big->str, out->str);
+  TEST_ASSERT_EQUAL(big->len, ej_write_value_size(value));
+  ej_free_value(value);
+  g_string_free(big, true);
+
+  g_string_truncate(out, 0);
+  TEST_ASSERT_FALSE(ej_write_value(NULL, out));
+  TEST_ASSERT_EQUAL(0, out->len);
+  g_string_free(out, true);
+}
+
+typedef struct {
+  GString *out;
+  size_t largest;
+  guint fail_after;
+} SinkTarget;
+
+static EJBool sink_target_write(const EJString *data, size_t len, gpointer user_data) {
+  SinkTarget *target = user_data;
+
+  if (target->fail_after > 0 && --target->fail_after == 0) { return false; }
+  g_string_append_len(target->out, data, len);
+  target->largest = MAX(target->largest, len);
+  return true;
+}
+
+static void test_sink(void) {
+  gchar *path = g_build_filename(g_get_tmp_dir(), "ExtendJson-test-sink.json", NULL);
+  GString *array = g_string_new("[");
+  SinkTarget target = { g_string_new(""), 0, 0 };
+  GOutputStream *stream;
+  EJError *error = NULL;
+  EJValue *value;
+  EJSink *sink;
+  FILE *file;
+  gchar *out = NULL, *fout = NULL;
+  guint i;
+
+  for (i = 0; i < 2000; i++) {
+    g_string_append_printf(array, "%s{\"id\": %u, \"name\": \"item\\t%u\", tags<k: true>: [1.5, null]}", i > 0 ? "," : "", i, i);
+  }
+  g_string_append(array, "]");
+  value = ej_parse(&error, array->str);
+  TEST_ASSERT_NOT_NULL(value);
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+
+  /* the callback never gets more than the staging buffer */
+  sink = ej_sink_new(sink_target_write, NULL, &target, 256);
+  TEST_ASSERT_TRUE(ej_sink_write_value(sink, value));
+  TEST_ASSERT_TRUE(ej_sink_write(sink, "\n", 1));
+  TEST_ASSERT_TRUE(ej_sink_flush(sink));
+  ej_sink_free(sink);
+  TEST_ASSERT_TRUE(target.largest <= 256);
+  g_string_append_c(target.out, '\0');
+  TEST_ASSERT_EQUAL_STRING_LEN(out, target.out->str, strlen(out));
+  TEST_ASSERT_EQUAL_STRING("\n", target.out->str + strlen(out));
+
+  /* a failed write stops the sink */
+  g_string_truncate(target.out, 0);
+  target.fail_after = 3;
+  sink = ej_sink_new(sink_target_write, NULL, &target, 256);
+  TEST_ASSERT_FALSE(ej_sink_write_value(sink, value));
+  TEST_ASSERT_FALSE(ej_sink_flush(sink));
+  ej_sink_free(sink);
+  TEST_ASSERT_TRUE(target.out->len > 0 && target.out->len <= 512);
+  TEST_ASSERT_EQUAL_STRING_LEN(out, target.out->str, target.out->len);
+
+  file = g_fopen(path, "wb");
+  sink = ej_sink_file_new(file, 0);
+  TEST_ASSERT_TRUE(ej_sink_write_value(sink, value));
+  TEST_ASSERT_TRUE(ej_sink_flush(sink));
+  ej_sink_free(sink);
+  fclose(file);
+  TEST_ASSERT_TRUE(g_file_get_contents(path, &fout, NULL, NULL));
+  TEST_ASSERT_EQUAL_STRING(out, fout);
+  g_free(fout);
+
+  file = g_fopen(path, "wb");
+  sink = ej_sink_fd_new(fileno(file), 1000);
+  TEST_ASSERT_TRUE(ej_sink_write_value(sink, value));
+  TEST_ASSERT_TRUE(ej_sink_flush(sink));
+  ej_sink_free(sink);
+  fclose(file);
+  TEST_ASSERT_TRUE(g_file_get_contents(path, &fout, NULL, NULL));
+  TEST_ASSERT_EQUAL_STRING(out, fout);
+  g_free(fout);
+
+  stream = g_memory_output_stream_new_resizable();
+  sink = ej_sink_stream_new(stream, 0);
+  TEST_ASSERT_TRUE(ej_sink_write_value(sink, value));
+  TEST_ASSERT_TRUE(ej_sink_flush(sink));
+  ej_sink_free(sink);
+  TEST_ASSERT_EQUAL(strlen(out), g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)));
+  TEST_ASSERT_EQUAL_STRING_LEN(out, g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(stream)), strlen(out));
+  g_object_unref(stream);
+
+  g_remove(path);
+  g_free(path);
+  g_free(out);
+  ej_free_value(value);
+  g_string_free(target.out, true);
+  g_string_free(array, true);
+}
+
+static void test_format_number(void) {
+  const double doubles[] = { 0.5, 1e-9, 0.1, 100.0, -0.0, 1e21, 123456.789, 5e-324, 1.7976931348623157e308 };
+  const gchar *texts[] = { "0.5", "1e-9", "0.1", "100.0", "-0.0", "1e21", "123456.789", "5e-324", "1.7976931348623157e308" };
+  EJString text[EJ_NUMBER_TEXT_SIZE + 1];
+  EJNumber number;
+  EJValue *value;
+  EJError *error = NULL;
+  guint64 bits = 0x9E3779B97F4A7C15ULL;
+  size_t i, len;
+
+  number.type = EJ_INT;
+  number.v.i = G_MININT;
+  len = ej_format_number(&number, text);
+  text[len] = '\0';
+  TEST_ASSERT_EQUAL_STRING("-2147483648", text);
+
+  number.type = EJ_DOUBLE;
+  for (i = 0; i < G_N_ELEMENTS(doubles); i++) {
+    number.v.d = doubles[i];
+    len = ej_format_number(&number, text);
+    text[len] = '\0';
+    TEST_ASSERT_EQUAL_STRING(texts[i], text);
+  }
+
+  /* every finite double parses back to itself */
+  for (i = 0; i < 100000; i++) {
+    bits ^= bits << 13;
+    bits ^= bits >> 7;
+    bits ^= bits << 17;
+    memcpy(&number.v.d, &bits, sizeof(bits));
+    if (((bits >> 52) & 0x7FF) == 0x7FF) { continue; }
+
+    len = ej_format_number(&number, text);
+    text[len] = '\0';
+    value = ej_parse(&error, text);
+    TEST_ASSERT_NOT_NULL(value);
+    TEST_ASSERT_EQUAL(EJ_DOUBLE, value->v.number->type);
+    TEST_ASSERT_TRUE(memcmp(&value->v.number->v.d, &bits, sizeof(bits)) == 0);
+    ej_free_value(value);
+  }
+}
+
+static void test_transcode(void) {
+  const gchar *inputs[] = {
+    "{ layout<key1: \"layoutvalue\", key2:[]>: { child1<childKey1: \"childValue1\">: [] } }",
+    "{ layout<key1: \"layoutvalue\", key2:[]>: { child1<@{bind:\"click\"}: \"click_handler\">: @{bind: \"value2\"} } }",
+    "[1, 2.50, \"a\\tb\", // comment\n {a: 1, b<>: 2, c<x<y:1>: 2>: {d: [true]},},]",
+    "{@{k: 1}: 2}",
+    "\"x\""
+  };
+  const gchar *outputs[] = {
+    "{\"layout\":{\"properties\":[{\"key1\":\"layoutvalue\",\"key2\":[]}],\"children\":[{\"name\":\"child1\",\"properties\":[{\"childKey1\":\"childValue1\"}],\"children\":[]}]}}",
+    "{\"layout\":{\"properties\":[{\"key1\":\"layoutvalue\",\"key2\":[]}],\"children\":[{\"name\":\"child1\",\"properties\":[{\"@{\\\"bind\\\":\\\"click\\\"}\":\"click_handler\"}],\"value\":{\"@\":{\"bind\":\"value2\"}}}]}}",
+    "[1,2.5,\"a\\tb\",{\"a\":1,\"b\":{\"properties\":[],\"value\":2},\"c\":{\"properties\":[{\"x\":{\"properties\":[{\"y\":1}],\"value\":2}}],\"children\":[{\"name\":\"d\",\"properties\":[],\"children\":[true]}]}}]",
+    "{\"@{\\\"k\\\":1}\":2}",
+    "\"x\""
+  };
+  SinkTarget target = { g_string_new(""), 0, 0 };
+  EJError *error = NULL, *events_error = NULL;
+  EJHandler handler = { NULL };
+  EJValue *value;
+  EJSink *sink;
+  gchar *out;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS(inputs); i++) {
+    out = ej_transcode_string(&error, inputs[i]);
+    TEST_ASSERT_NULL(error);
+    TEST_ASSERT_EQUAL_STRING(outputs[i], out);
+
+    value = ej_parse_options(EJ_PARSE_STRICT, &error, out);
+    TEST_ASSERT_NOT_NULL(value);
+    ej_free_value(value);
+    g_free(out);
+  }
+
+  /* the staging buffer is smaller than the output */
+  sink = ej_sink_new(sink_target_write, NULL, &target, 64);
+  TEST_ASSERT_TRUE(ej_transcode(sink, &error, inputs[1]));
+  TEST_ASSERT_TRUE(ej_sink_flush(sink));
+  ej_sink_free(sink);
+  g_string_append_c(target.out, '\0');
+  TEST_ASSERT_EQUAL_STRING(outputs[1], target.out->str);
+
+  /* a failed write stops the parse */
+  g_string_truncate(target.out, 0);
+  target.fail_after = 1;
+  sink = ej_sink_new(sink_target_write, NULL, &target, 64);
+  TEST_ASSERT_FALSE(ej_transcode(sink, &error, inputs[1]));
+  TEST_ASSERT_EQUAL_STRING("Stopped by handler", error->message);
+  ej_free_error(error);
+  error = NULL;
+  ej_sink_free(sink);
+
+  /* the same error as the events */
+  out = ej_transcode_string(&error, "{a<b: 1>: [1, 2 3]}");
+  TEST_ASSERT_NULL(out);
+  TEST_ASSERT_FALSE(ej_parse_events(&handler, NULL, &events_error, "{a<b: 1>: [1, 2 3]}"));
+  TEST_ASSERT_EQUAL_STRING(events_error->message, error->message);
+  TEST_ASSERT_EQUAL(events_error->row, error->row);
+  TEST_ASSERT_EQUAL(events_error->col, error->col);
+  ej_free_error(events_error);
+  ej_free_error(error);
+
+  g_string_free(target.out, true);
+}
+
+static void test_import_json_tree(void) {
+  const gchar *layout = "{\"layout\": {\"properties\": [{\"key1\": \"layoutvalue\", \"key2\": []}], \"children\": [{"
+                        "\"name\": \"child1\", \"properties\": [{\"childKey1\": \"childValue1\"}], \"children\": []}]}}";
+  const gchar *extended[] = {
+    "{ layout<key1: \"layoutvalue\", key2:[]>: { child1<@{bind:\"click\"}: \"click_handler\">: @{bind: \"value2\"} } }",
+    "[1, 2.5, {a: 1, b<>: 2, c<x<y:1>: 2>: {d: [true], @{z: 1}: {e: null}}}]"
+  };
+  const gchar *plain[] = {
+    "{\"children\":[{\"name\":\"x\",\"properties\":[],\"value\":1}]}",
+    "[{\"name\":\"x\",\"properties\":[],\"value\":1},2]",
+    "{\"properties\":[],\"children\":[{\"name\":\"x\",\"properties\":[],\"value\":1}],\"more\":1}"
+  };
+  EJError *error = NULL;
+  EJValue *value, *found;
+  EJObjectPair *pair;
+  gchar *std, *out = NULL, *again;
+  guint i;
+
+  value = ej_import_json_tree(&error, layout);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_TRUE(ej_object_get_value(value->v.object, "layout", &found));
+  TEST_ASSERT_EQUAL(EJ_OBJECT, found->type);
+  pair = g_ptr_array_index(value->v.object, 0);
+  TEST_ASSERT_EQUAL(2, pair->props->len);
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_EQUAL_STRING("{\"layout\"<\"key1\":\"layoutvalue\",\"key2\":[]>:{\"child1\"<\"childKey1\":\"childValue1\">:[]}}", out);
+  g_free(out);
+  ej_free_value(value);
+
+  /* back from ej_transcode to the same standard json */
+  for (i = 0; i < G_N_ELEMENTS(extended); i++) {
+    std = ej_transcode_string(&error, extended[i]);
+    value = ej_import_json_tree(&error, std);
+    TEST_ASSERT_NOT_NULL(value);
+    TEST_ASSERT_TRUE(ej_print_value(value, &out));
+    again = ej_transcode_string(&error, out);
+    TEST_ASSERT_EQUAL_STRING(std, again);
+    g_free(again);
+    g_free(out);
+    g_free(std);
+    ej_free_value(value);
+  }
+
+  value = ej_import_json_tree(&error, "{\"@{\\\"bind\\\":\\\"click\\\"}\": {\"@\": {\"a\": 1}}}");
+  TEST_ASSERT_TRUE(ej_print_value(value, &out));
+  TEST_ASSERT_EQUAL_STRING("{@{\"bind\":\"click\"}:@{\"a\":1}}", out);
+  g_free(out);
+  ej_free_value(value);
+
+  /* no node layout around them, these stay as they are */
+  for (i = 0; i < G_N_ELEMENTS(plain); i++) {
+    value = ej_import_json_tree(&error, plain[i]);
+    TEST_ASSERT_TRUE(ej_print_value(value, &out));
+    TEST_ASSERT_EQUAL_STRING(plain[i], out);
+    g_free(out);
+    ej_free_value(value);
+  }
+
+  TEST_ASSERT_NULL(ej_import_json_tree(&error, "{\"a\": 1, b: 2}"));
+  TEST_ASSERT_EQUAL_STRING("Key should be a quoted string", error->message);
+  TEST_ASSERT_EQUAL(10, error->col);
+  ej_free_error(error);
+}
+
 int main() {
   UNITY_BEGIN();
   {
@@ -320,6 +1695,39 @@ int main() {
     RUN_TEST(test_comment_with_new_line);
     RUN_TEST(test_comment_follow_comment);
     RUN_TEST(test_with_emoji);
+    RUN_TEST(test_parse_arena);
+    RUN_TEST(test_parse_arena_fail);
+    RUN_TEST(test_parse_insitu);
+    RUN_TEST(test_parse_insitu_error_position);
+    RUN_TEST(test_parse_bytes);
+    RUN_TEST(test_indented_error_position);
+    RUN_TEST(test_offset_to_position);
+    RUN_TEST(test_parse_empty);
+    RUN_TEST(test_parse_number);
+    RUN_TEST(test_parse_number_invalid);
+    RUN_TEST(test_object_index);
+    RUN_TEST(test_object_index_rebuild);
+    RUN_TEST(test_parse_key_table);
+    RUN_TEST(test_parse_iterative);
+    RUN_TEST(test_parse_iterative_depth);
+    RUN_TEST(test_parse_events);
+    RUN_TEST(test_push_parser);
+    RUN_TEST(test_push_parser_error);
+    RUN_TEST(test_parse_len);
+    RUN_TEST(test_parse_file);
+    RUN_TEST(test_cursor);
+    RUN_TEST(test_parse_indexed);
+    RUN_TEST(test_document);
+    RUN_TEST(test_parse_many);
+    RUN_TEST(test_parse_parallel);
+    RUN_TEST(test_parse_options);
+    RUN_TEST(test_unicode);
+    RUN_TEST(test_print_escape);
+    RUN_TEST(test_write_value);
+    RUN_TEST(test_sink);
+    RUN_TEST(test_format_number);
+    RUN_TEST(test_transcode);
+    RUN_TEST(test_import_json_tree);
   }
   UNITY_END();
   return 0;
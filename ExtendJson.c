@@ -1,9 +1,105 @@
 #include "ExtendJson.h"
+#include "ExtendJson-pow5.h"
+#include <float.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define EJ_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define EJ_SIMD_SSE2 1
+#endif
+
+#if _MSC_VER
+  #include <intrin.h>
+  #include <io.h>
+  #define ej_fd_write(fd, data, len) _write(fd, data, (unsigned int)(len))
+#else
+  #include <unistd.h>
+  #define ej_fd_write(fd, data, len) write(fd, data, len)
+#endif
+#include <errno.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define EJ_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif _MSC_VER
+  #define EJ_ALWAYS_INLINE __forceinline
+#else
+  #define EJ_ALWAYS_INLINE inline
+#endif
 
 #define EJ_DEBUG false
 #define EJ_LSTR(str) {sizeof(str) - 1, (EJString *)str}
 #define EJ_STR_MAX (INT_MAX - 2)
 #define ej_new0(struct_type, n_structs)  ej_malloc0(sizeof(struct_type) * n_structs)
+#define ej_buffer_new0(buffer, struct_type, n_structs)  ej_buffer_malloc0(buffer, sizeof(struct_type) * n_structs)
+#define EJ_ARENA_BLOCK_SIZE (64 * 1024)
+#define EJ_ARENA_ALIGN 8
+#define EJ_KEY_STACK_SIZE 64
+#define EJ_PUSH_LOOKAHEAD 4
+#define EJ_INDEX_CHUNK (16 * 1024)
+#define EJ_PARALLEL_MIN_CHUNK (64 * 1024)
+#define EJ_PARALLEL_CHUNKS_PER_THREAD 4
+#define EJ_MANY_BATCH 64
+#define EJ_MANY_BATCH_BYTES (64 * 1024)
+#define EJ_MANY_TASKS_PER_THREAD 4
+/* tape words, the tag is an EJ_TYPE or one of the two below in the top byte */
+#define EJ_TAPE_PROPS 16
+#define EJ_TAPE_END 17
+#define EJ_TAPE_WORD(tag, payload) (((guint64)(tag) << 56) | (guint64)(payload))
+#define EJ_TAPE_TAG(word) ((guint)((word) >> 56))
+#define EJ_TAPE_PAYLOAD(word) ((word) & G_GUINT64_CONSTANT(0x00ffffffffffffff))
+
+typedef struct _EJArenaBlock EJArenaBlock;
+
+struct _EJArenaBlock {
+  EJArenaBlock *next;
+  size_t size;
+  size_t used;
+};
+
+typedef struct _EJArenaData EJArenaData;
+
+struct _EJArenaData {
+  EJArenaData *next;
+  gpointer data;
+  GDestroyNotify func;
+};
+
+struct _EJArena {
+  EJArenaBlock *head;
+  size_t block_size;
+  /* memory the arena nodes point into, released with the arena */
+  EJArenaData *owned;
+};
+
+struct _EJKeyTable {
+  GMutex lock;
+  GHashTable *keys;
+};
+
+typedef enum _EJ_FRAME_TYPE EJ_FRAME_TYPE;
+
+enum _EJ_FRAME_TYPE {
+  EJ_FRAME_VALUE,
+  EJ_FRAME_ARRAY,
+  EJ_FRAME_OBJECT,
+  EJ_FRAME_PAIR,
+  EJ_FRAME_PROPS,
+  EJ_FRAME_KEY,
+};
+
+typedef struct _EJFrame EJFrame;
+
+struct _EJFrame {
+  EJ_FRAME_TYPE type;
+  int state;
+  size_t mark;
+  /* the value, key or pair being filled */
+  gpointer data;
+};
 
 struct _EJBuffer {
   const EJString *content;
@@ -11,6 +107,143 @@ struct _EJBuffer {
   size_t offset;
   EJError *error;
   EJ_MODE_TYPE mode;
+  EJArena *arena;
+  /* content is writable, strings are decoded in place and borrowed */
+  EJBool insitu;
+  /* keys are interned here instead of being copied */
+  EJKeyTable *keys;
+  /* line start offsets for error positions, built lazily */
+  size_t *lines;
+  size_t n_lines;
+  /* lines and columns before content, which is the tail of a stream in EJPushParser */
+  size_t origin_row;
+  size_t origin_col;
+  /* children of the containers being parsed, copied out when they close */
+  GPtrArray *stack;
+  /* EJ_MODE_ITERATIVE state, depth counts the open containers */
+  EJFrame *frames;
+  size_t n_frames;
+  size_t size_frames;
+  size_t depth;
+  size_t max_depth;
+  /* EJ_MODE_PARALLEL, 0 for one per processor */
+  guint n_threads;
+  /* the dialect of EJ_MODE_RECURSIVE and EJ_MODE_PARALLEL */
+  EJParseOptions options;
+  /* the content is checked before the first value is parsed */
+  EJBool validate_utf8;
+  /* ej_parse_events, escaped strings are decoded into scratch */
+  const EJHandler *handler;
+  gpointer user_data;
+  EJString *scratch;
+  size_t size_scratch;
+};
+
+typedef enum _EJ_LEX_STATE EJ_LEX_STATE;
+
+enum _EJ_LEX_STATE {
+  EJ_LEX_GAP,
+  EJ_LEX_WORD,
+  EJ_LEX_STRING,
+  EJ_LEX_ESCAPE,
+  EJ_LEX_SLASH,
+  EJ_LEX_LINE_FIRST,
+  EJ_LEX_LINE,
+  EJ_LEX_BLOCK_FIRST,
+  EJ_LEX_BLOCK,
+  EJ_LEX_BLOCK_STAR,
+};
+
+/* stage 1 of EJ_MODE_INDEXED, token starts and closing quotes ahead of stage 2 */
+typedef struct _EJIndex EJIndex;
+
+struct _EJIndex {
+  EJBuffer *buffer;
+  size_t *starts;
+  size_t n_starts;
+  size_t size_starts;
+  /* the first one stage 2 has not taken */
+  size_t next;
+  /* content before pos is indexed, state is the lexer state at pos */
+  size_t pos;
+  EJ_LEX_STATE state;
+  EJBool done;
+};
+
+struct _EJSink {
+  EJSinkWriteFunc write;
+  EJSinkFlushFunc flush;
+  gpointer user_data;
+  /* the staging buffer, its size is the most a sink holds at any time */
+  EJString *data;
+  size_t len;
+  size_t size;
+  /* a write failed, nothing more is written */
+  EJBool failed;
+};
+
+struct _EJPushParser {
+  EJBuffer *buffer;
+  /* the unconsumed tail of the stream, buffer->content points here */
+  EJString *data;
+  size_t size;
+  /* the iterative frames, their result is carried from feed to feed */
+  EJBool ret;
+  gpointer result;
+  EJBool started;
+  /* a terminator was fed, the rest of the stream is ignored as ej_parse does */
+  EJBool ended;
+  /* complete tokens ahead of the offset, a frame only steps when it can't read past them */
+  EJ_LEX_STATE lex_state;
+  size_t lex_pos;
+  size_t lex_start;
+  size_t starts[EJ_PUSH_LOOKAHEAD];
+  size_t ends[EJ_PUSH_LOOKAHEAD];
+  size_t n_tokens;
+};
+
+/* a parsed document in two flat arrays. a container or props is its begin
+ * word whose payload is the index of its end word, whose payload is the number
+ * of children. a member is its key, a props if it has one and its value. a
+ * number is two words, its EJ_NUMBER_TYPE and then its bits. string payloads
+ * are offsets into strings of a guint32 length followed by the bytes and '\0'. */
+struct _EJDocument {
+  guint64 *tape;
+  size_t n_tape;
+  size_t size_tape;
+  EJString *strings;
+  size_t n_strings;
+  size_t size_strings;
+  /* while building, the begin words of the open containers */
+  size_t *open;
+  size_t n_open;
+  size_t size_open;
+  EJBool eobject;
+};
+
+/* ej_parse_many, a task is a batch of consecutive documents parsed by one worker */
+typedef struct _EJManyTask EJManyTask;
+typedef struct _EJMany EJMany;
+
+struct _EJManyTask {
+  EJMany *many;
+  size_t first;
+  size_t n;
+  size_t starts[EJ_MANY_BATCH];
+  size_t ends[EJ_MANY_BATCH];
+  EJValue *values[EJ_MANY_BATCH];
+  EJError *errors[EJ_MANY_BATCH];
+  EJBool done;
+};
+
+struct _EJMany {
+  const EJString *content;
+  size_t length;
+  /* finds the boundaries and turns offsets into positions */
+  EJBuffer *scan;
+  EJBool scanned;
+  GMutex mutex;
+  GCond cond;
 };
 
 static const EJString* EJ_TYPE_NAMES[EJ_RAW] = {
@@ -25,11 +258,51 @@ static const EJLString EJ_TOKEN_STR[EJ_TOKEN_RAW] = {
   EJ_LSTR("<"), EJ_LSTR(">"), EJ_LSTR(":"), EJ_LSTR("."), EJ_LSTR("\0")
 };
 
+/* lexer, every byte is classified by one table lookup */
+typedef enum _EJ_CHAR_CLASS EJ_CHAR_CLASS;
+
+enum _EJ_CHAR_CLASS {
+  EJ_CHAR_SPACE = 1 << 0,
+  /* bare keys */
+  EJ_CHAR_KEY = 1 << 1,
+  /* numbers and literals, the key bytes and '.' '+' */
+  EJ_CHAR_WORD = 1 << 2,
+};
+
+#define EJ_CHAR_K (EJ_CHAR_KEY | EJ_CHAR_WORD)
+
+static const guint8 EJ_CHAR_CLASSES[256] = {
+  [' '] = EJ_CHAR_SPACE, ['\r'] = EJ_CHAR_SPACE, ['\n'] = EJ_CHAR_SPACE,
+  ['.'] = EJ_CHAR_WORD, ['+'] = EJ_CHAR_WORD, ['-'] = EJ_CHAR_K, ['_'] = EJ_CHAR_K,
+  ['0'] = EJ_CHAR_K, ['1'] = EJ_CHAR_K, ['2'] = EJ_CHAR_K, ['3'] = EJ_CHAR_K, ['4'] = EJ_CHAR_K,
+  ['5'] = EJ_CHAR_K, ['6'] = EJ_CHAR_K, ['7'] = EJ_CHAR_K, ['8'] = EJ_CHAR_K, ['9'] = EJ_CHAR_K,
+  ['A'] = EJ_CHAR_K, ['B'] = EJ_CHAR_K, ['C'] = EJ_CHAR_K, ['D'] = EJ_CHAR_K, ['E'] = EJ_CHAR_K,
+  ['F'] = EJ_CHAR_K, ['G'] = EJ_CHAR_K, ['H'] = EJ_CHAR_K, ['I'] = EJ_CHAR_K, ['J'] = EJ_CHAR_K,
+  ['K'] = EJ_CHAR_K, ['L'] = EJ_CHAR_K, ['M'] = EJ_CHAR_K, ['N'] = EJ_CHAR_K, ['O'] = EJ_CHAR_K,
+  ['P'] = EJ_CHAR_K, ['Q'] = EJ_CHAR_K, ['R'] = EJ_CHAR_K, ['S'] = EJ_CHAR_K, ['T'] = EJ_CHAR_K,
+  ['U'] = EJ_CHAR_K, ['V'] = EJ_CHAR_K, ['W'] = EJ_CHAR_K, ['X'] = EJ_CHAR_K, ['Y'] = EJ_CHAR_K,
+  ['Z'] = EJ_CHAR_K,
+  ['a'] = EJ_CHAR_K, ['b'] = EJ_CHAR_K, ['c'] = EJ_CHAR_K, ['d'] = EJ_CHAR_K, ['e'] = EJ_CHAR_K,
+  ['f'] = EJ_CHAR_K, ['g'] = EJ_CHAR_K, ['h'] = EJ_CHAR_K, ['i'] = EJ_CHAR_K, ['j'] = EJ_CHAR_K,
+  ['k'] = EJ_CHAR_K, ['l'] = EJ_CHAR_K, ['m'] = EJ_CHAR_K, ['n'] = EJ_CHAR_K, ['o'] = EJ_CHAR_K,
+  ['p'] = EJ_CHAR_K, ['q'] = EJ_CHAR_K, ['r'] = EJ_CHAR_K, ['s'] = EJ_CHAR_K, ['t'] = EJ_CHAR_K,
+  ['u'] = EJ_CHAR_K, ['v'] = EJ_CHAR_K, ['w'] = EJ_CHAR_K, ['x'] = EJ_CHAR_K, ['y'] = EJ_CHAR_K,
+  ['z'] = EJ_CHAR_K,
+};
+
+/* the value a byte starts, 0 for none. literals still have to be compared */
+static const guint8 EJ_VALUE_STARTS[256] = {
+  ['t'] = EJ_BOOLEAN, ['f'] = EJ_BOOLEAN, ['n'] = EJ_NULL, ['"'] = EJ_STRING,
+  ['['] = EJ_ARRAY, ['{'] = EJ_OBJECT, ['@'] = EJ_EOBJECT, ['-'] = EJ_NUMBER,
+  ['0'] = EJ_NUMBER, ['1'] = EJ_NUMBER, ['2'] = EJ_NUMBER, ['3'] = EJ_NUMBER, ['4'] = EJ_NUMBER,
+  ['5'] = EJ_NUMBER, ['6'] = EJ_NUMBER, ['7'] = EJ_NUMBER, ['8'] = EJ_NUMBER, ['9'] = EJ_NUMBER,
+};
+
 /* declare */
-static void ej_print_value_inner(EJValue *data, gpointer user_data);
-static void ej_print_object_pair_inner(EJObjectPair *value, gpointer user_data);
-static void ej_print_array_value_inner(size_t arrlen, size_t index, EJValue *data, gpointer user_data);
 static void ej_comment(EJBuffer *buffer);
+static EJBool ej_parse_value_iterative(EJBuffer *buffer, EJValue **data);
+static EJBool ej_parse_value_indexed(EJBuffer *buffer, EJValue **data);
+static EJBool ej_parse_value_parallel(EJBuffer *buffer, EJValue **data);
 
 static inline void ej_assert_object_pair(EJObjectPair *data) {
   ej_assert(data != NULL);
@@ -56,6 +329,102 @@ EJ_MODULE_EXPORT(void*) ej_malloc0(size_t size) {
   return pt;
 }
 
+/* arena */
+static EJArenaBlock *ej_arena_block_new(size_t size) {
+  EJArenaBlock *block = ej_malloc0(sizeof(EJArenaBlock) + size);
+
+  block->size = size;
+  block->used = 0;
+  return block;
+}
+
+EJ_MODULE_EXPORT(EJArena*) ej_arena_new(size_t block_size) {
+  EJArena *arena = ej_new0(EJArena, 1);
+
+  arena->block_size = block_size > 0 ? block_size : EJ_ARENA_BLOCK_SIZE;
+  arena->head = ej_arena_block_new(arena->block_size);
+
+  return arena;
+}
+
+EJ_MODULE_EXPORT(void*) ej_arena_alloc0(EJArena *arena, size_t size) {
+  EJArenaBlock *block;
+  void *pt;
+
+  ej_assert(arena != NULL);
+  size = (size + EJ_ARENA_ALIGN - 1) & ~(size_t)(EJ_ARENA_ALIGN - 1);
+
+  if (size > arena->block_size / 4) {
+    /* big chunks get their own block so the current one keeps filling */
+    block = ej_arena_block_new(size);
+    block->used = size;
+    block->next = arena->head->next;
+    arena->head->next = block;
+
+    return (char *)(block + 1);
+  }
+
+  block = arena->head;
+  if (block->used + size > block->size) {
+    block = ej_arena_block_new(arena->block_size);
+    block->next = arena->head;
+    arena->head = block;
+  }
+
+  pt = (char *)(block + 1) + block->used;
+  block->used += size;
+
+  return pt;
+}
+
+static EJString *ej_arena_strndup(EJArena *arena, const EJString *str, size_t len) {
+  EJString *nstr = ej_arena_alloc0(arena, len + 1);
+
+  memcpy(nstr, str, len);
+  return nstr;
+}
+
+static EJArray *ej_arena_ptr_array_new(EJArena *arena, gpointer *pdata, size_t len) {
+  EJArray *arr = ej_arena_alloc0(arena, sizeof(EJArray));
+
+  if (len > 0) {
+    arr->pdata = ej_arena_alloc0(arena, sizeof(gpointer) * len);
+    memcpy(arr->pdata, pdata, sizeof(gpointer) * len);
+  }
+  arr->len = (guint)len;
+
+  return arr;
+}
+
+EJ_MODULE_EXPORT(void) ej_arena_take(EJArena *arena, gpointer data, GDestroyNotify func) {
+  EJArenaData *owned;
+
+  ej_return_if_fail(arena != NULL);
+
+  owned = ej_arena_alloc0(arena, sizeof(EJArenaData));
+  owned->data = data;
+  owned->func = func;
+  owned->next = arena->owned;
+  arena->owned = owned;
+}
+
+EJ_MODULE_EXPORT(void) ej_arena_free(EJArena *arena) {
+  EJArenaBlock *block, *next;
+  EJArenaData *owned;
+
+  if (arena == NULL) { return; }
+
+  for (owned = arena->owned; owned != NULL; owned = owned->next) {
+    owned->func(owned->data);
+  }
+
+  for (block = arena->head; block != NULL; block = next) {
+    next = block->next;
+    ej_free(block);
+  }
+  ej_free(arena);
+}
+
 static size_t ej_strlen(const EJString *s) {
   size_t len;
 
@@ -67,6 +436,57 @@ static size_t ej_strlen(const EJString *s) {
   return len;
 }
 
+/* key table */
+EJ_MODULE_EXPORT(EJKeyTable*) ej_key_table_new(void) {
+  EJKeyTable *keys = ej_new0(EJKeyTable, 1);
+
+  ej_mutex_init(&keys->lock);
+  keys->keys = ej_hash_table_new_full(ej_str_hash, g_str_equal, g_free, NULL);
+
+  return keys;
+}
+
+static const EJString *ej_key_table_intern_len(EJKeyTable *keys, const EJString *key, size_t len) {
+  EJString stack[EJ_KEY_STACK_SIZE];
+  EJString *nkey, *interned;
+
+  if (len < EJ_KEY_STACK_SIZE) {
+    memcpy(stack, key, len);
+    stack[len] = '\0';
+    nkey = stack;
+  }
+  else {
+    nkey = ej_strndup(key, len);
+  }
+
+  ej_mutex_lock(&keys->lock);
+  interned = ej_hash_table_lookup(keys->keys, nkey);
+  if (interned == NULL) {
+    interned = nkey == stack ? ej_strndup(key, len) : nkey;
+    ej_hash_table_insert(keys->keys, interned, interned);
+  }
+  ej_mutex_unlock(&keys->lock);
+
+  if (nkey != stack && nkey != interned) {
+    ej_free(nkey);
+  }
+  return interned;
+}
+
+EJ_MODULE_EXPORT(const EJString*) ej_key_table_intern(EJKeyTable *keys, const EJString *key) {
+  ej_return_val_if_fail(keys != NULL && key != NULL, NULL);
+
+  return ej_key_table_intern_len(keys, key, ej_strlen(key));
+}
+
+EJ_MODULE_EXPORT(void) ej_key_table_free(EJKeyTable *keys) {
+  if (keys == NULL) { return; }
+
+  ej_hash_table_destroy(keys->keys);
+  ej_mutex_clear(&keys->lock);
+  ej_free(keys);
+}
+
 EJBool ej_value_equal(EJValue *v1, EJValue *v2) {
   if (v1->type == EJ_STRING && v2->type == EJ_STRING) {
     return ej_str_equal(v1->v.string, v2->v.string);
@@ -83,9 +503,64 @@ void ej_free_number(EJNumber *data) {
   ej_free(data);
 }
 
+/* nested frees are queued here instead of recursing, so freeing a deep
+ * tree uses a fixed amount of C stack */
+typedef struct _EJFreeQueue EJFreeQueue;
+
+struct _EJFreeQueue {
+  GPtrArray *values;
+  GPtrArray *pairs;
+};
+
+static GPrivate ej_free_queue = G_PRIVATE_INIT(NULL);
+
+static void ej_free_value_inner(EJValue *data);
+static void ej_free_object_pair_inner(EJObjectPair *data);
+
+static void ej_free_deferred(gpointer data, EJBool pair) {
+  EJFreeQueue *queue = ej_private_get(&ej_free_queue);
+  EJFreeQueue local = { NULL, NULL };
+  GPtrArray **pending;
+
+  if (queue != NULL) {
+    pending = pair ? &queue->pairs : &queue->values;
+    if (*pending == NULL) { *pending = ej_ptr_array_new(); }
+    ej_ptr_array_add(*pending, data);
+    return;
+  }
+
+  ej_private_set(&ej_free_queue, &local);
+  if (pair) {
+    ej_free_object_pair_inner(data);
+  }
+  else {
+    ej_free_value_inner(data);
+  }
+
+  while (true) {
+    if (local.pairs != NULL && local.pairs->len > 0) {
+      ej_free_object_pair_inner(ej_ptr_array_remove_index(local.pairs, local.pairs->len - 1));
+    }
+    else if (local.values != NULL && local.values->len > 0) {
+      ej_free_value_inner(ej_ptr_array_remove_index(local.values, local.values->len - 1));
+    }
+    else {
+      break;
+    }
+  }
+  ej_private_set(&ej_free_queue, NULL);
+
+  if (local.values != NULL) { ej_free_ptr_array(local.values); }
+  if (local.pairs != NULL) { ej_free_ptr_array(local.pairs); }
+}
+
 EJ_MODULE_EXPORT(void) ej_free_value(EJValue *data) {
   ej_assert_value(data);
 
+  ej_free_deferred(data, false);
+}
+
+static void ej_free_value_inner(EJValue *data) {
   if(data->v.object != NULL) {
     switch (data->type) {
       case EJ_BOOLEAN:
@@ -95,7 +570,9 @@ EJ_MODULE_EXPORT(void) ej_free_value(EJValue *data) {
         break;
       }
       case EJ_STRING: {
-        ej_free(data->v.string);
+        if (!(data->flags & EJ_VALUE_FLAG_BORROWED)) {
+          ej_free(data->v.string);
+        }
         break;
       }
       case EJ_NUMBER: {
@@ -123,6 +600,10 @@ EJ_MODULE_EXPORT(void) ej_free_value(EJValue *data) {
 void ej_free_object_pair(EJObjectPair *data) {
   ej_assert_object_pair(data);
 
+  ej_free_deferred(data, true);
+}
+
+static void ej_free_object_pair_inner(EJObjectPair *data) {
   if (data->key != NULL) {
     ej_free_value(data->key);
   }
@@ -148,9 +629,88 @@ EJ_MODULE_EXPORT(void) ej_free_buffer(EJBuffer *buffer) {
   if(buffer->error->message == NULL) {
     ej_free(buffer->error);
   }
+  ej_free(buffer->lines);
+  ej_free(buffer->frames);
+  ej_free(buffer->scratch);
+  ej_free_ptr_array(buffer->stack);
   ej_free(buffer);
 }
 
+static void *ej_buffer_malloc0(EJBuffer *buffer, size_t size) {
+  if (buffer->arena != NULL) {
+    return ej_arena_alloc0(buffer->arena, size);
+  }
+
+  return ej_malloc0(size);
+}
+
+static EJString *ej_buffer_strndup(EJBuffer *buffer, const EJString *str, size_t len) {
+  if (buffer->arena != NULL) {
+    return ej_arena_strndup(buffer->arena, str, len);
+  }
+
+  return ej_strndup(str, len);
+}
+
+/* uninitialized room for len bytes and the terminator */
+static EJString *ej_buffer_string_new(EJBuffer *buffer, size_t len) {
+  if (buffer->arena != NULL) {
+    return ej_arena_alloc0(buffer->arena, len + 1);
+  }
+
+  return ej_malloc(len + 1);
+}
+
+static void ej_buffer_free_value(EJBuffer *buffer, EJValue *data) {
+  if (buffer->arena != NULL || data == NULL) { return; }
+
+  ej_free_value(data);
+}
+
+static void ej_buffer_free_object_pair(EJBuffer *buffer, EJObjectPair *data) {
+  if (buffer->arena != NULL || data == NULL) { return; }
+
+  ej_free_object_pair(data);
+}
+
+static size_t ej_buffer_stack_mark(EJBuffer *buffer) {
+  return buffer->stack->len;
+}
+
+static void ej_buffer_stack_push(EJBuffer *buffer, gpointer data) {
+  ej_ptr_array_add(buffer->stack, data);
+}
+
+/* move the children pushed since mark into an exactly sized container */
+static EJArray *ej_buffer_stack_pop_array(EJBuffer *buffer, size_t mark, GDestroyNotify func) {
+  EJArray *arr;
+  size_t i, len = buffer->stack->len - mark;
+
+  if (buffer->arena != NULL) {
+    arr = ej_arena_ptr_array_new(buffer->arena, buffer->stack->pdata + mark, len);
+  }
+  else {
+    arr = ej_ptr_array_new_full((guint)len, func);
+    for (i = 0; i < len; i++) {
+      ej_ptr_array_add(arr, buffer->stack->pdata[mark + i]);
+    }
+  }
+  ej_ptr_array_set_size(buffer->stack, (gint)mark);
+
+  return arr;
+}
+
+static void ej_buffer_stack_discard(EJBuffer *buffer, size_t mark, GDestroyNotify func) {
+  size_t i;
+
+  if (buffer->arena == NULL) {
+    for (i = mark; i < buffer->stack->len; i++) {
+      func(buffer->stack->pdata[i]);
+    }
+  }
+  ej_ptr_array_set_size(buffer->stack, (gint)mark);
+}
+
 EJ_MODULE_EXPORT(EJObjectPair*) ej_object_pair_new() {
   EJObjectPair *pair = ej_new0(EJObjectPair, 1);
 
@@ -198,7 +758,8 @@ EJ_MODULE_EXPORT(EJString*) ej_read(EJBuffer *buffer, int pos) {
 }
 
 static const EJString ej_read_c_inner(EJBuffer *buffer, int pos) {
-  if (!ej_valid(buffer, pos)) {
+  /* the content does not have to be terminated */
+  if (!ej_valid(buffer, pos) || buffer->offset + pos >= buffer->length) {
     return '\0';
   }
 
@@ -212,10 +773,29 @@ EJBool ej_token_is(EJBuffer *buffer, EJ_TOKEN_TYPE etype) {
     return false;
   }
 
+  /* punctuation is a single byte */
+  if (token.len == 1) {
+    return *ej_read_inner(buffer, 0) == token.value[0];
+  }
+
   bl = (strncmp(token.value, ej_read_inner(buffer, 0), token.len) == 0);
   return bl;
 }
 
+/* the value starting at the offset from its first byte, EJ_INVALID for none */
+static EJ_TYPE ej_lex_value(EJBuffer *buffer) {
+  guint8 type = EJ_VALUE_STARTS[(guint8)ej_read_c_inner(buffer, 0)];
+
+  switch (type) {
+    case EJ_BOOLEAN:
+      return ej_token_is(buffer, EJ_TOKEN_TRUE) || ej_token_is(buffer, EJ_TOKEN_FALSE) ? EJ_BOOLEAN : EJ_INVALID;
+    case EJ_NULL:
+      return ej_token_is(buffer, EJ_TOKEN_NULL) ? EJ_NULL : EJ_INVALID;
+    default:
+      return type ? (EJ_TYPE)type : EJ_INVALID;
+  }
+}
+
 EJ_MODULE_EXPORT(EJBool) ej_ensure_char(EJBuffer *buffer, EJ_TOKEN_TYPE ch) {
   if (!ej_skip_whitespace(buffer)) {
     return false;
@@ -248,869 +828,5887 @@ void ej_skip_c(EJBuffer *buffer, EJString c) {
     return;
   }
 
-  if (c == '\n') {
-    ej_skip_line(buffer, 1, 1);
-  }
-  else {
-    ej_skip_line(buffer, 1, 0);
-  }
+  buffer->offset += 1;
 }
 
+/* rows are not tracked any more, positions come from ej_offset_to_position */
 EJ_MODULE_EXPORT(void) ej_skip_line(EJBuffer *buffer, int cols, int rows) {
-  if (rows == 0) {
-    buffer->error->col += cols;
-  } else {
-    buffer->error->col = 1;
-#if EJ_DEBUG
-    printf("[new line]%ld,%c\n", buffer->error->row, ej_read_c(buffer, -1));
-#endif
-  }
-
-  buffer->error->row += rows;
   buffer->offset = buffer->offset + cols;
 }
 
 EJ_MODULE_EXPORT(void) ej_buffer_skip(EJBuffer *buffer, int pos) {
   if (buffer == NULL || pos == 0) { return; }
 
-  ej_skip_line(buffer, pos, 0);
+  buffer->offset = buffer->offset + pos;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_skip_whitespace(EJBuffer *buffer) {
-  EJString c;
-  while (true) {
-    c = ej_read_c_inner(buffer, 0);
-    if (c == '\0') { return false;}
-    if (c == ' ' || c == '\r' || c == '\n') {
-      ej_skip_c(buffer, c);
-      continue;
-    }
+/* start offsets of all lines, built on the first position lookup */
+static void ej_buffer_build_lines(EJBuffer *buffer) {
+  const EJString *p, *nl, *end = buffer->content + buffer->length;
+  size_t n = 1;
 
-    ej_comment(buffer);
-    break;
+  for (p = buffer->content; p < end && (nl = memchr(p, '\n', (size_t)(end - p))) != NULL; p = nl + 1) {
+    n++;
   }
 
-  return true;
+  buffer->lines = ej_new0(size_t, n);
+  buffer->n_lines = 1;
+  for (p = buffer->content; p < end && (nl = memchr(p, '\n', (size_t)(end - p))) != NULL; p = nl + 1) {
+    buffer->lines[buffer->n_lines++] = (size_t)(nl + 1 - buffer->content);
+  }
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_skip_utf8_bom(EJBuffer *buffer) {
-  if ((buffer == NULL) || (buffer->content == NULL) || (buffer->offset != 0)) {
-    return false;
+/* offsets behind the end count on as columns of the last line */
+static void ej_buffer_position(EJBuffer *buffer, size_t offset, size_t *row, size_t *col) {
+  size_t lo, hi, mid;
+
+  if (buffer->lines == NULL) {
+    ej_buffer_build_lines(buffer);
   }
 
-  if (ej_valid(buffer, 4) && (strncmp(ej_read_inner(buffer, 0), "\xEF\xBB\xBF", 3) == 0)) {
-    ej_buffer_skip(buffer, 3);
+  /* last line starting at or before offset */
+  lo = 0;
+  hi = buffer->n_lines;
+  while (hi - lo > 1) {
+    mid = lo + (hi - lo) / 2;
+    if (buffer->lines[mid] <= offset) {
+      lo = mid;
+    }
+    else {
+      hi = mid;
+    }
   }
 
-  return true;
+  *row = lo + 1 + buffer->origin_row;
+  *col = offset - buffer->lines[lo] + 1 + (lo == 0 ? buffer->origin_col : 0);
 }
 
-static EJString ej_next_c_inner(EJBuffer *buffer) {
-  ej_skip_c(buffer, ej_read_c_inner(buffer, 0));
+EJ_MODULE_EXPORT(EJBool) ej_offset_to_position(EJBuffer *buffer, size_t offset, size_t *row, size_t *col) {
+  ej_return_val_if_fail(buffer != NULL && row != NULL && col != NULL, false);
+  if (offset > buffer->length) { return false; }
 
-  return ej_read_c_inner(buffer, 0);
+  ej_buffer_position(buffer, offset, row, col);
+  return true;
 }
 
-EJ_MODULE_EXPORT(EJString) ej_next_c(EJBuffer *buffer) {
-  if (buffer == NULL) { return '\0'; }
+static inline unsigned int ej_ctz(unsigned int v) {
+#if _MSC_VER
+  unsigned long index;
 
-  return ej_next_c_inner(buffer);
+  _BitScanForward(&index, v);
+  return (unsigned int)index;
+#else
+  return (unsigned int)__builtin_ctz(v);
+#endif
 }
 
-static bool ej_comment_line(EJBuffer *buffer) {
-  EJString c;
-  while (true) {
-    c = ej_next_c_inner(buffer);
-    if (c == '\0') { return false; }
+static inline unsigned int ej_ctz64(guint64 v) {
+#if _MSC_VER && defined(_M_X64)
+  unsigned long index;
 
-    if (c == '\n') { break; }
-  }
+  _BitScanForward64(&index, v);
+  return (unsigned int)index;
+#elif _MSC_VER
+  return (guint32)v != 0 ? ej_ctz((guint32)v) : 32 + ej_ctz((guint32)(v >> 32));
+#else
+  return (unsigned int)__builtin_ctzll(v);
+#endif
+}
 
-  return true;
+static inline EJBool ej_is_whitespace(EJString c) {
+  return (EJ_CHAR_CLASSES[(guint8)c] & EJ_CHAR_SPACE) != 0;
 }
 
-static bool ej_comment_multiple(EJBuffer *buffer) {
-  EJString c;
+/* numbers, literals and bare keys */
+static inline EJBool ej_is_word_char(EJString c) {
+  return (EJ_CHAR_CLASSES[(guint8)c] & EJ_CHAR_WORD) != 0;
+}
 
-  while (true) {
-    c = ej_next_c_inner(buffer);
-    if (c == '\0') { ej_set_error(buffer, "mutiple line comment not close"); return false; }
-    if (c != '*') { continue; }
-    ej_buffer_skip(buffer, 1);
+static inline EJBool ej_is_key_char(EJString c) {
+  return (EJ_CHAR_CLASSES[(guint8)c] & EJ_CHAR_KEY) != 0;
+}
 
-    c = ej_read_c_inner(buffer, 0);
-    if (c == -1) { ej_set_error(buffer, "mutiple line comment not close"); return false; }
+/* first position from pos which is not whitespace, or len */
+static size_t ej_scan_whitespace(const EJString *content, size_t pos, size_t len) {
+  unsigned int mask;
 
-    if (c == '/') { ej_buffer_skip(buffer, 1); break; }
-  }
+  /* most runs are a single space, try it before loading a vector */
+  if (pos < len && !ej_is_whitespace(content[pos])) { return pos; }
 
-  return true;
-}
+#if EJ_SIMD_AVX2
+  const __m256i sp32 = _mm256_set1_epi8(' ');
+  const __m256i cr32 = _mm256_set1_epi8('\r');
+  const __m256i nl32 = _mm256_set1_epi8('\n');
 
-static void ej_comment(EJBuffer *buffer) {
-  EJString c;
+  for (; pos + 32 <= len; pos += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(content + pos));
+    __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp32), _mm256_cmpeq_epi8(v, cr32)),
+      _mm256_cmpeq_epi8(v, nl32));
 
-  c = ej_read_c_inner(buffer, 0);
-  if (c == '/') {
-    c = ej_read_c_inner(buffer, 1);
+    mask = ~(unsigned int)_mm256_movemask_epi8(ws);
+    if (mask != 0) { return pos + ej_ctz(mask); }
+  }
+#endif
+#if EJ_SIMD_AVX2 || EJ_SIMD_SSE2
+  const __m128i sp = _mm_set1_epi8(' ');
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i nl = _mm_set1_epi8('\n');
 
-    if (c == '/') {
-      ej_buffer_skip(buffer, 2);
-      ej_comment_line(buffer);
+  for (; pos + 16 <= len; pos += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(content + pos));
+    __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, cr)), _mm_cmpeq_epi8(v, nl));
 
-    } else if (c == '*') {
-      ej_buffer_skip(buffer, 2);
-      ej_comment_multiple(buffer);
-    }
-  } else {
-    return;
+    mask = ~(unsigned int)_mm_movemask_epi8(ws) & 0xFFFF;
+    if (mask != 0) { return pos + ej_ctz(mask); }
+  }
+#endif
+  (void)mask;
+
+  for (; pos < len; pos++) {
+    if (!ej_is_whitespace(content[pos])) { break; }
   }
 
-  ej_skip_whitespace(buffer);
+  return pos;
 }
 
-EJ_MODULE_EXPORT(const EJString *) ej_get_data_type_name(EJ_TYPE type) {
-  if (type < 0 || type > EJ_RAW) {
-    return NULL;
-  }
+/* a line comment body starts at pos and ends before the first '\n' behind
+ * its first byte, the reader always stepped over that byte unchecked. */
+static size_t ej_scan_comment_line(const EJString *content, size_t pos, size_t len) {
+  const EJString *nl;
 
-  return EJ_TYPE_NAMES[type];
+  if (pos + 1 >= len) { return len; }
+
+  nl = memchr(content + pos + 1, '\n', len - pos - 1);
+  return nl != NULL ? (size_t)(nl - content) : len;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_object_get_value(EJObject *data, EJString *key, EJValue **value) {
+/* a block comment body starts at pos, returns the position behind the closing
+ * star and slash, or len when it is not closed. As in the byte reader the first
+ * byte of the body and the byte behind a '*' which does not close are skipped. */
+static size_t ej_scan_comment_multiple(const EJString *content, size_t pos, size_t len, EJBool *closed) {
+  const EJString *star;
   size_t i;
-  EJObjectPair *pair = NULL;
-
-  for (i = 0; i < data->len; i++) {
-    pair = (EJObjectPair *)data->pdata[i];
-    ej_return_val_if_fail((pair != NULL) && (pair->key != NULL) && (pair->value != NULL), false);
 
-    if (pair->key->type != EJ_STRING) {
-      continue;
-    }
+  for (i = pos + 1; i < len; i = (size_t)(star - content) + 2) {
+    star = memchr(content + i, '*', len - i);
+    if (star == NULL) { break; }
 
-    if (ej_strcmp0((const char *)key, (const char *)pair->key->v.string) == 0) {
-      *value = pair->value;
-      return true;
+    if (star + 1 < content + len && star[1] == '/') {
+      *closed = true;
+      return (size_t)(star - content) + 2;
     }
   }
 
-  return false;
+  *closed = false;
+  return len;
 }
 
-void ej_set_errorv(EJBuffer *buffer, EJString *fmt, va_list args) {
-  buffer->error->message = ej_strdup_vprintf(fmt, args);
-  va_end(args);
-}
-
-EJ_MODULE_EXPORT(EJError*) ej_get_error(EJBuffer *buffer) {
-  return buffer->error;
+static inline void ej_buffer_advance(EJBuffer *buffer, size_t len) {
+  buffer->offset += len;
 }
 
-EJ_MODULE_EXPORT(void) ej_set_error(EJBuffer *buffer, EJString *fmt, ...) {
-  va_list args;
-
-  ej_assert(buffer != NULL && buffer->error != NULL && "buffer error should not be NULL");
-
-  if (buffer->error->message != NULL) {
-    return;
-  }
-
-  va_start(args, fmt);
-  buffer->error->message = ej_strdup_vprintf(fmt, args);
-  va_end(args);
+/* consume the comment at the offset, false when there is none */
+static EJBool ej_skip_comment(EJBuffer *buffer) {
+  EJBool closed = true;
+  size_t end;
 
-#if EJ_DEBUG
-  printf("Error in <%ld, %ld>: %s", buffer->error->row, buffer->error->col, buffer->error->message);
-#endif 
-}
+  if (ej_read_c_inner(buffer, 0) != '/') { return false; }
 
-/* print */
-EJ_MODULE_EXPORT(EJBool) ej_print_number(EJNumber *data, EJString **buffer) {
-  switch (data->type)
-  {
-    case EJ_INT:
-      *buffer = ej_strdup_printf("%d", data->v.i);
+  switch (ej_read_c_inner(buffer, 1)) {
+    case '/':
+      ej_buffer_advance(buffer, 2);
+      end = ej_scan_comment_line(buffer->content, buffer->offset, buffer->length);
       break;
-    case EJ_DOUBLE:
-      *buffer = ej_strdup_printf("%lf", data->v.d);
+    case '*':
+      ej_buffer_advance(buffer, 2);
+      end = ej_scan_comment_multiple(buffer->content, buffer->offset, buffer->length, &closed);
       break;
     default:
-      break;
+      return false;
   }
+  ej_buffer_advance(buffer, end - buffer->offset);
 
-  return true;
-}
+  if (!closed) {
+    ej_set_error(buffer, "mutiple line comment not close");
+  }
 
-EJ_MODULE_EXPORT(EJBool) ej_print_bool(EJBool data, EJString **buffer) {
-  *buffer = data ? ej_strdup("true"): ej_strdup("false");
   return true;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_print_array_value(size_t arrlen, size_t index, EJValue *data, EJString **buffer) {
-  GString *value;
-  EJString *str = NULL;
-
-  ej_assert(index < arrlen);
+EJ_MODULE_EXPORT(EJBool) ej_skip_whitespace(EJBuffer *buffer) {
+  size_t end;
 
-  value = ej_string_new("");
-  if (ej_print_value(data, &str)) {
-    value = ej_string_append(value, str); ej_free(str);
-  }
+  end = ej_scan_whitespace(buffer->content, buffer->offset, buffer->length);
+  ej_buffer_advance(buffer, end - buffer->offset);
+  if (ej_read_c_inner(buffer, 0) == '\0') { return false; }
 
-  if (index + 1 == arrlen) {
-    *buffer = value->str;
-  }
-  else {
-    value = ej_string_append(value, ",");
-    *buffer = value->str;
+  while (ej_skip_comment(buffer)) {
+    end = ej_scan_whitespace(buffer->content, buffer->offset, buffer->length);
+    ej_buffer_advance(buffer, end - buffer->offset);
   }
-  ej_string_free(value, false);
 
   return true;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_print_array(EJArray *data, EJString **buffer) {
-  GString *value;
-  EJString *str;
-  size_t i, len;
-  if (!data) { return false; }
+EJ_MODULE_EXPORT(EJBool) ej_skip_utf8_bom(EJBuffer *buffer) {
+  if ((buffer == NULL) || (buffer->content == NULL) || (buffer->offset != 0)) {
+    return false;
+  }
 
-  value = ej_string_new("[");
-  len = data->len;
-  for (i = 0; i < len; i++) {
-    ej_print_array_value_inner(len, i, data->pdata[i], &str);
-    value = ej_string_append(value, str); ej_free(str);
+  if (ej_valid(buffer, 4) && (strncmp(ej_read_inner(buffer, 0), "\xEF\xBB\xBF", 3) == 0)) {
+    ej_buffer_skip(buffer, 3);
   }
-  value = ej_string_append(value, "]");
-  *buffer = value->str; ej_string_free(value, false);
 
   return true;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_print_object_pair_prop(EJArray *data, EJString **buffer) {
-  EJString *prop = NULL;
-  EJObjectPair *op = NULL;
-  GString *value;
-  guint size, i;
+/* utf-8, the length of the valid sequence at pos, 0 when it is not valid or cut off */
+static size_t ej_utf8_char_len(const guint8 *p, size_t pos, size_t len) {
+  guint8 c = p[pos], lo = 0x80, hi = 0xBF;
+  size_t n, i;
 
-  if (!data) { return false; }
+  if (c < 0x80) { return 1; }
+  if (c < 0xC2 || c > 0xF4) { return 0; }
 
-  value = ej_string_new("<");
-  size = data->len;
+  if (c < 0xE0) {
+    n = 2;
+  }
+  else if (c < 0xF0) {
+    n = 3;
+    /* overlong and surrogates */
+    if (c == 0xE0) { lo = 0xA0; }
+    else if (c == 0xED) { hi = 0x9F; }
+  }
+  else {
+    n = 4;
+    /* overlong and above U+10FFFF */
+    if (c == 0xF0) { lo = 0x90; }
+    else if (c == 0xF4) { hi = 0x8F; }
+  }
 
-  for(i = 0; i < data->len;i++) {
-    op = data->pdata[i];
+  if (pos + n > len || p[pos + 1] < lo || p[pos + 1] > hi) { return 0; }
+  for (i = 2; i < n; i++) {
+    if ((p[pos + i] & 0xC0) != 0x80) { return 0; }
+  }
+
+  return n;
+}
 
-    if (ej_print_object_pair(op, &prop)) {
-      value = ej_string_append(value, prop);ej_free(prop);
+/* the first invalid position from pos, or len. ascii runs are skipped 16 bytes at a time */
+static size_t ej_scan_utf8(const guint8 *p, size_t pos, size_t len) {
+  size_t n;
 
-      if(i + 1 < size) {
-        value = ej_string_append(value, ",");
-      }
+  while (pos < len) {
+#if EJ_SIMD_AVX2 || EJ_SIMD_SSE2
+    if (pos + 16 <= len && _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(p + pos))) == 0) {
+      pos += 16;
+      continue;
     }
+#endif
+    n = ej_utf8_char_len(p, pos, len);
+    if (n == 0) { break; }
+    pos += n;
   }
-  value = ej_string_append(value, ">");
-
-  *buffer = value->str; ej_string_free(value, false);
 
-  return true;
+  return pos;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_print_object_pair(EJObjectPair *data, EJString **buffer) {
-  ej_return_val_if_fail(data->key != NULL, false);
+#if EJ_SIMD_AVX2
+/* the lookup algorithm of Keiser and Lemire, every byte is classified by its
+ * high nibble, the low nibble of the byte before it and the high nibble of that
+ * byte, one error bit for each way a sequence can be wrong. The two bytes and
+ * three bytes back are compared for the third and fourth byte of a sequence. */
+#define EJ_UTF8_TOO_SHORT (1 << 0)
+#define EJ_UTF8_TOO_LONG (1 << 1)
+#define EJ_UTF8_OVERLONG_3 (1 << 2)
+#define EJ_UTF8_TOO_LARGE (1 << 3)
+#define EJ_UTF8_SURROGATE (1 << 4)
+#define EJ_UTF8_OVERLONG_2 (1 << 5)
+#define EJ_UTF8_TOO_LARGE_1000 (1 << 6)
+#define EJ_UTF8_OVERLONG_4 (1 << 6)
+#define EJ_UTF8_TWO_CONTS ((char)0x80)
+#define EJ_UTF8_CARRY (EJ_UTF8_TOO_SHORT | EJ_UTF8_TOO_LONG | EJ_UTF8_TWO_CONTS)
+#define EJ_UTF8_LARGE (EJ_UTF8_CARRY | EJ_UTF8_TOO_LARGE | EJ_UTF8_TOO_LARGE_1000)
+#define EJ_UTF8_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+/* the bytes n back, the first ones from the previous block */
+#define EJ_UTF8_PREV(input, prev, n) _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+static inline __m256i ej_utf8_check_block(__m256i input, __m256i prev) {
+  const __m256i byte_1_high_table = EJ_UTF8_TABLE(
+    EJ_UTF8_TOO_LONG, EJ_UTF8_TOO_LONG, EJ_UTF8_TOO_LONG, EJ_UTF8_TOO_LONG,
+    EJ_UTF8_TOO_LONG, EJ_UTF8_TOO_LONG, EJ_UTF8_TOO_LONG, EJ_UTF8_TOO_LONG,
+    EJ_UTF8_TWO_CONTS, EJ_UTF8_TWO_CONTS, EJ_UTF8_TWO_CONTS, EJ_UTF8_TWO_CONTS,
+    EJ_UTF8_TOO_SHORT | EJ_UTF8_OVERLONG_2,
+    EJ_UTF8_TOO_SHORT,
+    EJ_UTF8_TOO_SHORT | EJ_UTF8_OVERLONG_3 | EJ_UTF8_SURROGATE,
+    EJ_UTF8_TOO_SHORT | EJ_UTF8_TOO_LARGE | EJ_UTF8_TOO_LARGE_1000 | EJ_UTF8_OVERLONG_4);
+  const __m256i byte_1_low_table = EJ_UTF8_TABLE(
+    EJ_UTF8_CARRY | EJ_UTF8_OVERLONG_3 | EJ_UTF8_OVERLONG_2 | EJ_UTF8_OVERLONG_4,
+    EJ_UTF8_CARRY | EJ_UTF8_OVERLONG_2,
+    EJ_UTF8_CARRY, EJ_UTF8_CARRY,
+    EJ_UTF8_CARRY | EJ_UTF8_TOO_LARGE,
+    EJ_UTF8_LARGE, EJ_UTF8_LARGE, EJ_UTF8_LARGE, EJ_UTF8_LARGE, EJ_UTF8_LARGE,
+    EJ_UTF8_LARGE, EJ_UTF8_LARGE, EJ_UTF8_LARGE,
+    EJ_UTF8_LARGE | EJ_UTF8_SURROGATE,
+    EJ_UTF8_LARGE, EJ_UTF8_LARGE);
+  const __m256i byte_2_high_table = EJ_UTF8_TABLE(
+    EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT,
+    EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT,
+    EJ_UTF8_TOO_LONG | EJ_UTF8_OVERLONG_2 | EJ_UTF8_TWO_CONTS | EJ_UTF8_OVERLONG_3 | EJ_UTF8_TOO_LARGE_1000 | EJ_UTF8_OVERLONG_4,
+    EJ_UTF8_TOO_LONG | EJ_UTF8_OVERLONG_2 | EJ_UTF8_TWO_CONTS | EJ_UTF8_OVERLONG_3 | EJ_UTF8_TOO_LARGE,
+    EJ_UTF8_TOO_LONG | EJ_UTF8_OVERLONG_2 | EJ_UTF8_TWO_CONTS | EJ_UTF8_SURROGATE | EJ_UTF8_TOO_LARGE,
+    EJ_UTF8_TOO_LONG | EJ_UTF8_OVERLONG_2 | EJ_UTF8_TWO_CONTS | EJ_UTF8_SURROGATE | EJ_UTF8_TOO_LARGE,
+    EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT, EJ_UTF8_TOO_SHORT);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  __m256i prev1 = EJ_UTF8_PREV(input, prev, 1), special, must23;
+
+  special = _mm256_and_si256(
+    _mm256_and_si256(_mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+      _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, nibble))),
+    _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+  /* a continuation behind a continuation is the third or fourth byte of a sequence */
+  must23 = _mm256_or_si256(_mm256_subs_epu8(EJ_UTF8_PREV(input, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80))),
+    _mm256_subs_epu8(EJ_UTF8_PREV(input, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80))));
+
+  return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8((char)0x80)), special);
+}
 
-  EJString *prop = NULL, *value = NULL, *key = NULL;
+/* len when valid, otherwise a position at or before the first error */
+static size_t ej_scan_utf8_avx2(const guint8 *p, size_t len) {
+  /* a lead byte in the last three which needs more bytes than are left */
+  const __m256i max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+  __m256i input, prev = _mm256_setzero_si256(), incomplete = _mm256_setzero_si256(), error;
+  guint8 tail[32];
+  size_t pos;
+
+  for (pos = 0; pos < len; pos += 32) {
+    if (pos + 32 <= len) {
+      input = _mm256_loadu_si256((const __m256i *)(p + pos));
+    }
+    else {
+      /* the zeros behind a cut off sequence are too short for it */
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, p + pos, len - pos);
+      input = _mm256_loadu_si256((const __m256i *)tail);
+    }
 
-  if (!ej_print_value(data->key, &key)) {
-    goto fail;
+    if (_mm256_movemask_epi8(input) == 0) {
+      /* a cut off sequence is only missed when plain ascii follows it */
+      error = incomplete;
+      incomplete = _mm256_setzero_si256();
+    }
+    else {
+      error = ej_utf8_check_block(input, prev);
+      incomplete = _mm256_subs_epu8(input, max);
+    }
+    if (!_mm256_testz_si256(error, error)) { break; }
+    prev = input;
   }
 
-  if (!ej_print_object_pair_prop(data->props, &prop)) {
-    prop = ej_strdup("");
-  }
+  if (pos >= len && _mm256_testz_si256(incomplete, incomplete)) { return len; }
 
-  if (!ej_print_value(data->value, &value)) {
-    value = ej_strdup("");
+  /* the error is in a sequence starting at most three bytes back, from the
+   * first byte of a character the scalar scan finds it */
+  pos = MIN(pos, len);
+  pos = pos > 3 ? pos - 3 : 0;
+  while (pos > 0 && (p[pos] & 0xC0) == 0x80) {
+    pos--;
   }
 
-  *buffer = ej_strdup_printf("%s%s:%s", key, prop, value);
+  return pos;
+}
+#endif
 
-  ej_free(key);
-  ej_free(prop);
-  ej_free(value);
-  return true;
-fail:
-  return false;
+EJ_MODULE_EXPORT(EJBool) ej_validate_utf8(const EJString *content, size_t len, size_t *offset) {
+  const guint8 *p = (const guint8 *)content;
+  size_t pos = 0;
+
+  ej_return_val_if_fail(content != NULL, false);
+
+#if EJ_SIMD_AVX2
+  pos = ej_scan_utf8_avx2(p, len);
+#endif
+  pos = ej_scan_utf8(p, pos, len);
+
+  if (offset != NULL) { *offset = pos; }
+  return pos == len;
 }
 
-EJBool ej_print_eobject(EJObject *data, EJString **buffer) {
-  GString *value;
+static EJString ej_next_c_inner(EJBuffer *buffer) {
+  ej_skip_c(buffer, ej_read_c_inner(buffer, 0));
 
-  if (!data) { return false; }
+  return ej_read_c_inner(buffer, 0);
+}
 
-  value = ej_string_new("@");
-  if (!ej_print_object(data, buffer)) {
-    return false;
+EJ_MODULE_EXPORT(EJString) ej_next_c(EJBuffer *buffer) {
+  if (buffer == NULL) { return '\0'; }
+
+  return ej_next_c_inner(buffer);
+}
+
+static void ej_comment(EJBuffer *buffer) {
+  if (ej_skip_comment(buffer)) {
+    ej_skip_whitespace(buffer);
   }
+}
 
-  value = ej_string_append(value, *buffer); ej_free(*buffer);
-  *buffer = value->str; ej_string_free(value, false);
+EJ_MODULE_EXPORT(const EJString *) ej_get_data_type_name(EJ_TYPE type) {
+  if (type < 0 || type > EJ_RAW) {
+    return NULL;
+  }
 
-  return true;
+  return EJ_TYPE_NAMES[type];
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_print_object(EJObject *data, EJString **buffer) {
-  GString *value;
+/* object index, a hash of the keys of one object which its caller owns */
+struct _EJObjectIndex {
+  GHashTable *keys;
+};
 
-  if (!data) { return false; }
+EJ_MODULE_EXPORT(EJObjectIndex*) ej_object_index_new(EJObject *data) {
+  EJObjectIndex *index;
+  EJObjectPair *pair;
+  size_t i;
+
+  ej_return_val_if_fail(data != NULL, NULL);
 
-  value = ej_string_new("{");
+  for (i = 0; i < data->len; i++) {
+    pair = (EJObjectPair *)data->pdata[i];
+    if (pair == NULL || pair->key == NULL || pair->value == NULL) { return NULL; }
+  }
+
+  index = ej_new0(EJObjectIndex, 1);
+  index->keys = ej_hash_table_new(ej_str_hash, g_str_equal);
 
-  if (data->len > 0) {
-    ej_ptr_array_foreach(data, (EJFunc)ej_print_object_pair_inner, buffer);
-    if(*buffer == NULL) { return false; }
+  for (i = 0; i < data->len; i++) {
+    pair = (EJObjectPair *)data->pdata[i];
+    if (pair->key->type != EJ_STRING) {
+      continue;
+    }
 
-    value = ej_string_append(value, *buffer); ej_free(*buffer);
-    value = ej_string_truncate(value, (value->len-1)); // delete last ','
+    /* first pair wins, same as the linear lookup */
+    if (ej_hash_table_lookup(index->keys, pair->key->v.string) == NULL) {
+      ej_hash_table_insert(index->keys, pair->key->v.string, pair);
+    }
   }
 
-  value = ej_string_append(value, "}");
+  return index;
+}
 
-  *buffer = value->str; ej_string_free(value, false);
+EJ_MODULE_EXPORT(EJBool) ej_object_index_get_value(EJObjectIndex *index, const EJString *key, EJValue **value) {
+  EJObjectPair *pair;
+
+  ej_return_val_if_fail(index != NULL && key != NULL && value != NULL, false);
 
+  pair = ej_hash_table_lookup(index->keys, key);
+  if (pair == NULL) { return false; }
+
+  *value = pair->value;
   return true;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_print_value(EJValue *data, EJString **buffer) {
-  if (!data) { return false; };
+EJ_MODULE_EXPORT(void) ej_object_index_free(EJObjectIndex *index) {
+  if (index == NULL) { return; }
 
-  switch (data->type)
-  {
-    case EJ_BOOLEAN:
-      return ej_print_bool(data->v.bvalue, buffer);
-    case EJ_NULL: {
-      *buffer = ej_strdup("null");
-      return true;
+  ej_hash_table_destroy(index->keys);
+  ej_free(index);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_object_get_value(EJObject *data, EJString *key, EJValue **value) {
+  size_t i;
+  EJObjectPair *pair = NULL;
+
+  for (i = 0; i < data->len; i++) {
+    pair = (EJObjectPair *)data->pdata[i];
+    ej_return_val_if_fail((pair != NULL) && (pair->key != NULL) && (pair->value != NULL), false);
+
+    if (pair->key->type != EJ_STRING) {
+      continue;
     }
-    case EJ_STRING: {
-      *buffer = ej_strdup_printf("\"%s\"", data->v.string);
+
+    if (key == pair->key->v.string || ej_strcmp0((const char *)key, (const char *)pair->key->v.string) == 0) {
+      *value = pair->value;
       return true;
     }
-    case EJ_NUMBER: {
-      return ej_print_number(data->v.number, buffer);
-    }
-    case EJ_ARRAY: {
-      return ej_print_array(data->v.array, buffer);
-    }
-    case EJ_EOBJECT:
-      return ej_print_eobject(data->v.object, buffer);
-    case EJ_OBJECT: {
-      return ej_print_object(data->v.object, buffer);
-    }
-    case EJ_INVALID:
-    case EJ_RAW:
-    default:
-      return false;
   }
-}
 
-static void ej_print_value_inner(EJValue *data, gpointer user_data) {
-  ej_print_value(data, user_data);
+  return false;
 }
 
-static void ej_print_object_pair_inner(EJObjectPair *pair, gpointer user_data) {
-  EJString *str = NULL;
-  EJString **udata;
-  GString *value;
+EJ_MODULE_EXPORT(EJBool) ej_object_get_interned(EJObject *data, const EJString *key, EJValue **value) {
+  size_t i;
+  EJObjectPair *pair = NULL;
 
-  udata = (EJString **)user_data;
-  if(*udata != NULL) {
-    value = ej_string_new(*udata); ej_free(*udata);
-  }
-  else {
-    value = ej_string_new("");
-  }
+  for (i = 0; i < data->len; i++) {
+    pair = (EJObjectPair *)data->pdata[i];
+    ej_return_val_if_fail((pair != NULL) && (pair->key != NULL) && (pair->value != NULL), false);
 
-  if(!ej_print_object_pair(pair, &str)) {
-    return;
+    if (pair->key->type != EJ_STRING) {
+      continue;
+    }
+
+    /* interned keys are equal only when they are the same pointer */
+    if (key == pair->key->v.string
+      || (!(pair->key->flags & EJ_VALUE_FLAG_INTERNED) && ej_strcmp0((const char *)key, (const char *)pair->key->v.string) == 0)) {
+      *value = pair->value;
+      return true;
+    }
   }
 
-  value = ej_string_append(value, str); ej_free(str);
-  value = ej_string_append(value, ",");
+  return false;
+}
 
-  *udata = (gpointer)value->str;
-  ej_string_free(value, false);
+void ej_set_errorv(EJBuffer *buffer, EJString *fmt, va_list args) {
+  buffer->error->message = ej_strdup_vprintf(fmt, args);
+  va_end(args);
 }
 
-static void ej_print_array_value_inner(size_t arrlen, size_t index, EJValue *data, gpointer user_data) {
-  ej_print_array_value(arrlen, index, data, user_data);
+EJ_MODULE_EXPORT(EJError*) ej_get_error(EJBuffer *buffer) {
+  ej_buffer_position(buffer, buffer->offset, &buffer->error->row, &buffer->error->col);
+
+  return buffer->error;
 }
 
-/* parse */
-EJ_MODULE_EXPORT(EJBool) ej_parse_bool(EJBuffer *buffer, EJBool *data) {
-  ej_return_val_if_fail(data != NULL, false);
+EJ_MODULE_EXPORT(void) ej_set_error(EJBuffer *buffer, EJString *fmt, ...) {
+  va_list args;
 
-  if (ej_token_is(buffer, EJ_TOKEN_FALSE)) {
-    *data = false;
-  }
-  else if (ej_token_is(buffer, EJ_TOKEN_TRUE)) {
-    *data = true;
-  }
-  else {
-    return false;
+  ej_assert(buffer != NULL && buffer->error != NULL && "buffer error should not be NULL");
+
+  if (buffer->error->message != NULL) {
+    return;
   }
 
-  return true;
+  va_start(args, fmt);
+  buffer->error->message = ej_strdup_vprintf(fmt, args);
+  va_end(args);
+
+#if EJ_DEBUG
+  ej_get_error(buffer);
+  printf("Error in <%ld, %ld>: %s", buffer->error->row, buffer->error->col, buffer->error->message);
+#endif 
 }
 
-static EJBool ej_parse_array_inner(EJBuffer *buffer, EJArray **data) {
-  EJArray *arr;
-  EJValue *value = NULL;
+/* print */
+/* first position from pos which has to be escaped in a string, or len */
+static size_t ej_scan_escape(const EJString *s, size_t pos, size_t len) {
+  unsigned int mask;
+
+#if EJ_SIMD_AVX2
+  const __m256i quote32 = _mm256_set1_epi8('"');
+  const __m256i backslash32 = _mm256_set1_epi8('\\');
+  const __m256i control32 = _mm256_set1_epi8(0x1F);
+
+  for (; pos + 32 <= len; pos += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(s + pos));
+    /* unsigned v <= 0x1F is min(v, 0x1F) == v */
+    __m256i esc = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, backslash32)),
+      _mm256_cmpeq_epi8(_mm256_min_epu8(v, control32), v));
+
+    mask = (unsigned int)_mm256_movemask_epi8(esc);
+    if (mask != 0) { return pos + ej_ctz(mask); }
+  }
+#endif
+#if EJ_SIMD_AVX2 || EJ_SIMD_SSE2
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1F);
+
+  for (; pos + 16 <= len; pos += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + pos));
+    __m128i esc = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+      _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+
+    mask = (unsigned int)_mm_movemask_epi8(esc);
+    if (mask != 0) { return pos + ej_ctz(mask); }
+  }
+#endif
+  (void)mask;
 
-  ej_buffer_skip(buffer, 1);
+  for (; pos < len; pos++) {
+    guint8 c = (guint8)s[pos];
+    if (c == '"' || c == '\\' || c < 0x20) { break; }
+  }
 
-  arr = ej_value_array_new();
-  if (ej_ensure_char(buffer, EJ_TOKEN_BKT_END)) { goto success; }
+  return pos;
+}
 
-  while (true) {
-    if (!ej_parse_value(buffer, &value)) {
-      goto fail;
-    }
-    ej_ptr_array_add(arr, (gpointer)value);
+/* staged bytes go to write when the buffer is full or flushed */
+static EJBool ej_sink_drain(EJSink *sink) {
+  if (sink->len > 0 && !sink->failed && !sink->write(sink->data, sink->len, sink->user_data)) {
+    sink->failed = true;
+  }
+  sink->len = 0;
 
-    if (ej_ensure_char(buffer, EJ_TOKEN_COMMA)) {
-      ej_buffer_skip(buffer, 1);
+  return !sink->failed;
+}
 
-      if (ej_ensure_char(buffer, EJ_TOKEN_BKT_END)) {
-        break;
+static void ej_sink_append(EJSink *sink, const EJString *data, size_t len) {
+  if (sink->len + len > sink->size) {
+    ej_sink_drain(sink);
+    /* larger than the buffer, it goes out as it is */
+    if (len > sink->size) {
+      if (!sink->failed && !sink->write(data, len, sink->user_data)) {
+        sink->failed = true;
       }
-    } 
-    else if (ej_token_is(buffer, EJ_TOKEN_BKT_END)) {
-      break;
-    }
-    else {
-      goto fail;
+      return;
     }
   }
 
-success:
-  if (!ej_token_is(buffer, EJ_TOKEN_BKT_END)) {
-    goto fail;
-  }
-  ej_buffer_skip(buffer, 1);
+  memcpy(sink->data + sink->len, data, len);
+  sink->len += len;
+}
 
-  *data = arr;
-  return true;
-fail:
-  ej_set_error(buffer, "Parse array failed");
-  ej_free_ptr_array(arr);
-  return false;
+static EJ_ALWAYS_INLINE void ej_sink_append_c(EJSink *sink, EJString c) {
+  if (sink->len == sink->size) { ej_sink_drain(sink); }
+  sink->data[sink->len++] = c;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_parse_array(EJBuffer *buffer, EJArray **data) {
-  if (!ej_token_is(buffer, EJ_TOKEN_BKT_START)) {
-    return false;
-  }
+#define ej_sink_append_str(sink, str) ej_sink_append(sink, str, sizeof(str) - 1)
+
+static void ej_sink_init(EJSink *sink, EJSinkWriteFunc write, EJSinkFlushFunc flush, gpointer user_data,
+                         EJString *data, size_t size) {
+  sink->write = write;
+  sink->flush = flush;
+  sink->user_data = user_data;
+  sink->data = data;
+  sink->len = 0;
+  sink->size = size;
+  sink->failed = false;
+}
 
-  return ej_parse_array_inner(buffer, data);
+static EJBool ej_sink_string_write(const EJString *data, size_t len, gpointer user_data) {
+  ej_string_append_len((GString *)user_data, data, len);
+  return true;
 }
 
-static EJString *ej_remove_escaped_string(EJString *data, size_t len, size_t skip) {
-  ej_assert(data != NULL && len <= ej_strlen(data) && skip < len);
-
-  size_t i = 0, j = 0;
-  EJString c, n;
-  EJString *ndata = data;
-
-  while(i < len) {
-    c = *(data + i);
-    if (c == '\0') { return data; }
-
-    if (c == '\\') {
-      i += 1;
-      n = *(data + i);
-
-      switch (n)
-      {
-      case 'b':
-        c = '\b';
-        break;
-      case 'f':
-        c = '\f';
-        break;
-      case 'n':
-        c = '\n';
+/* the len bytes of s quoted, the runs between escapes are copied whole */
+static void ej_sink_append_escaped(EJSink *sink, const EJString *s, size_t len) {
+  static const char hex[] = "0123456789abcdef";
+  size_t pos = 0, end;
+  guint8 c;
+
+  ej_sink_append_c(sink, '"');
+  while (pos < len) {
+    end = ej_scan_escape(s, pos, len);
+    ej_sink_append(sink, s + pos, end - pos);
+    if (end == len) { break; }
+
+    c = (guint8)s[end];
+    ej_sink_append_c(sink, '\\');
+    switch (c)
+    {
+      case '"':
+      case '\\':
+        ej_sink_append_c(sink, c);
         break;
-      case 'r':
-        c = '\r';
+      case '\b':
+        ej_sink_append_c(sink, 'b');
         break;
-      case 't':
-        c = '\t';
+      case '\f':
+        ej_sink_append_c(sink, 'f');
         break;
-      case '\"':
-        c = '\"';
+      case '\n':
+        ej_sink_append_c(sink, 'n');
         break;
-      case '\\':
-        c = '\\';
+      case '\r':
+        ej_sink_append_c(sink, 'r');
         break;
-      // case 'u':
-      //   break;
-      case '/':
-        c = '/';
+      case '\t':
+        ej_sink_append_c(sink, 't');
         break;
       default:
-        goto fail;
-      }
+        ej_sink_append_str(sink, "u00");
+        ej_sink_append_c(sink, hex[c >> 4]);
+        ej_sink_append_c(sink, hex[c & 0xF]);
+        break;
     }
+    pos = end + 1;
+  }
+  ej_sink_append_c(sink, '"');
+}
 
-    *(ndata + j) = c;
-    j += 1;
-    i += 1;
+/* exact length ej_sink_append_escaped adds for s */
+static size_t ej_escaped_size(const EJString *s) {
+  size_t len = strlen(s), pos = 0, end, size = 2;
+  guint8 c;
+
+  while (pos < len) {
+    end = ej_scan_escape(s, pos, len);
+    size += end - pos;
+    if (end == len) { break; }
+
+    c = (guint8)s[end];
+    size += (c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') ? 2 : 6;
+    pos = end + 1;
   }
 
-  ndata[j] = '\0';
-  return ndata;
+  return size;
+}
 
-fail:
-  ej_free(ndata);
-  return NULL;
+/* formatted straight into the staging buffer */
+static void ej_write_number(EJNumber *data, EJSink *sink) {
+  if (sink->size - sink->len < EJ_NUMBER_TEXT_SIZE) { ej_sink_drain(sink); }
+  sink->len += ej_format_number(data, sink->data + sink->len);
 }
 
-static EJBool ej_parse_string_inner(EJBuffer *buffer, EJString **data) {
-  size_t len = 0;
-  EJString c, n;
-  size_t skip = 0;
-  EJString *ndata;
+/* what ej_write_value_inner refuses, checked before a separator is written */
+static EJBool ej_value_writable(EJValue *data) {
+  if (!data) { return false; }
 
-  ej_buffer_skip(buffer, 1);
+  switch (data->type)
+  {
+    case EJ_BOOLEAN:
+    case EJ_NULL:
+    case EJ_STRING:
+    case EJ_NUMBER:
+      return true;
+    case EJ_ARRAY:
+      return data->v.array != NULL;
+    case EJ_EOBJECT:
+    case EJ_OBJECT:
+      return data->v.object != NULL;
+    case EJ_INVALID:
+    case EJ_RAW:
+    default:
+      return false;
+  }
+}
 
-  len = 0;
-  while (true) {
-    c = ej_read_c_inner(buffer, (int)len);
-    if (c == '\0') { ej_set_error(buffer, "occur buffer end when parse string"); return false; }
+static EJBool ej_object_pair_writable(EJObjectPair *data) {
+  ej_return_val_if_fail(data->key != NULL, false);
+  return ej_value_writable(data->key);
+}
 
-    if (c == '\\') {
-      n = ej_read_c(buffer, len + 1);
-      skip += 1;
+static EJBool ej_write_value_inner(EJValue *data, EJSink *sink);
+static EJBool ej_write_value_size_inner(EJValue *data, size_t *size);
 
-      switch (n)
-      {
-      case 'b':
-        break;
-      case 'f':
-        break;
-      case 'n':
-        break;
-      case 'r':
-        break;
-      case 't':
-        break;
-      case '\"':
-      case '\\':
-      // case 'u':
-      //   break;
-      case '/':
-        len = len + 1;
-        break;
-      default:
-        ej_set_error(buffer, "occur not support escaped char %c when parse string", n);
-        return false;
-      }
-    }
+/* a value which can not be written leaves an empty slot */
+static void ej_write_array(EJArray *data, EJSink *sink) {
+  size_t i;
 
-    if (c == '\"' || len + 1 > EJ_STR_MAX) {
-      break;
+  ej_sink_append_c(sink, '[');
+  for (i = 0; i < data->len; i++) {
+    if (i > 0) { ej_sink_append_c(sink, ','); }
+    ej_write_value_inner(data->pdata[i], sink);
+  }
+  ej_sink_append_c(sink, ']');
+}
+
+static EJBool ej_write_object_pair(EJObjectPair *data, EJSink *sink);
+
+static void ej_write_object_pair_prop(EJArray *data, EJSink *sink) {
+  size_t i;
+
+  ej_sink_append_c(sink, '<');
+  for (i = 0; i < data->len; i++) {
+    if (ej_write_object_pair(data->pdata[i], sink) && i + 1 < data->len) {
+      ej_sink_append_c(sink, ',');
     }
+  }
+  ej_sink_append_c(sink, '>');
+}
 
-    len++;
+static EJBool ej_write_object_pair(EJObjectPair *data, EJSink *sink) {
+  if (!ej_object_pair_writable(data)) {
+    return false;
   }
 
-  ndata = (EJString *) ej_strndup(ej_read_inner(buffer, 0), len);
-  *data = ej_remove_escaped_string(ndata, len, skip);
+  ej_write_value_inner(data->key, sink);
+  if (data->props) {
+    ej_write_object_pair_prop(data->props, sink);
+  }
+  ej_sink_append_c(sink, ':');
+  ej_write_value_inner(data->value, sink);
 
-  if(*data == NULL) {
-    ej_free(ndata);
-    goto fail;
+  return true;
+}
+
+/* pairs which can not be written are left out */
+static void ej_write_object(EJObject *data, EJSink *sink) {
+  EJBool first = true;
+  size_t i;
+
+  ej_sink_append_c(sink, '{');
+  for (i = 0; i < data->len; i++) {
+    if (!ej_object_pair_writable(data->pdata[i])) { continue; }
+    if (!first) { ej_sink_append_c(sink, ','); }
+    ej_write_object_pair(data->pdata[i], sink);
+    first = false;
+  }
+  ej_sink_append_c(sink, '}');
+}
+
+static EJBool ej_write_value_inner(EJValue *data, EJSink *sink) {
+  if (!ej_value_writable(data)) { return false; }
+
+  switch (data->type)
+  {
+    case EJ_BOOLEAN:
+      if (data->v.bvalue) {
+        ej_sink_append_str(sink, "true");
+      }
+      else {
+        ej_sink_append_str(sink, "false");
+      }
+      break;
+    case EJ_NULL:
+      ej_sink_append_str(sink, "null");
+      break;
+    case EJ_STRING:
+      ej_sink_append_escaped(sink, data->v.string, strlen(data->v.string));
+      break;
+    case EJ_NUMBER:
+      ej_write_number(data->v.number, sink);
+      break;
+    case EJ_ARRAY:
+      ej_write_array(data->v.array, sink);
+      break;
+    case EJ_EOBJECT:
+      ej_sink_append_c(sink, '@');
+      ej_write_object(data->v.object, sink);
+      break;
+    case EJ_OBJECT:
+      ej_write_object(data->v.object, sink);
+      break;
+    default:
+      break;
   }
 
-  ej_buffer_skip(buffer, len + 1);
   return true;
+}
 
-fail:
-  ej_set_error(buffer, "Parse string failed");
-  return false;
+/* runs one of the writers with the string as its sink */
+#define EJ_WRITE_STRING(string, call) do { \
+  EJString staging[4096]; \
+  EJSink sink; \
+  ej_sink_init(&sink, ej_sink_string_write, NULL, string, staging, sizeof(staging)); \
+  call; \
+  ej_sink_drain(&sink); \
+} while (0)
+
+EJ_MODULE_EXPORT(EJBool) ej_write_value(EJValue *data, GString *out) {
+  EJBool ret = false;
+
+  EJ_WRITE_STRING(out, ret = ej_write_value_inner(data, &sink));
+  return ret;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_parse_string(EJBuffer *buffer, EJString **data) {
-  if (!ej_token_is(buffer, EJ_TOKEN_QMARK)) {
+/* the same walk as the writers, adding up lengths */
+static EJBool ej_write_object_pair_size(EJObjectPair *data, size_t *size) {
+  size_t i;
+
+  if (!ej_object_pair_writable(data)) {
     return false;
   }
 
-  return ej_parse_string_inner(buffer, data);
+  ej_write_value_size_inner(data->key, size);
+  if (data->props) {
+    *size += 2;
+    for (i = 0; i < data->props->len; i++) {
+      if (ej_write_object_pair_size(data->props->pdata[i], size) && i + 1 < data->props->len) {
+        *size += 1;
+      }
+    }
+  }
+
+  *size += 1;
+  ej_write_value_size_inner(data->value, size);
+
+  return true;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_parse_key_without_quote(EJBuffer *buffer, EJString **data) {
-  EJString c;
-  size_t pos = 0;
+static EJBool ej_write_value_size_inner(EJValue *data, size_t *size) {
+  EJString text[EJ_NUMBER_TEXT_SIZE];
+  size_t i, n;
 
-  for (pos = 0; (c = ej_read_c(buffer, pos)) != '\0'; pos++) {
-    if (!ej_ascii_isalnum(c) && c != '-' && c != '_') {
-      if (pos == 0) {
-        ej_set_error(buffer, "Key length cannot be zero.");
-        return false;
+  if (!ej_value_writable(data)) { return false; }
+
+  switch (data->type)
+  {
+    case EJ_BOOLEAN:
+      *size += data->v.bvalue ? 4 : 5;
+      break;
+    case EJ_NULL:
+      *size += 4;
+      break;
+    case EJ_STRING:
+      *size += ej_escaped_size(data->v.string);
+      break;
+    case EJ_NUMBER:
+      *size += ej_format_number(data->v.number, text);
+      break;
+    case EJ_ARRAY:
+      *size += 2 + (data->v.array->len > 0 ? data->v.array->len - 1 : 0);
+      for (i = 0; i < data->v.array->len; i++) {
+        ej_write_value_size_inner(data->v.array->pdata[i], size);
       }
       break;
-    }
+    case EJ_EOBJECT:
+    case EJ_OBJECT:
+      *size += data->type == EJ_EOBJECT ? 3 : 2;
+      for (i = 0, n = 0; i < data->v.object->len; i++) {
+        if (ej_write_object_pair_size(data->v.object->pdata[i], size)) { n++; }
+      }
+      *size += n > 0 ? n - 1 : 0;
+      break;
+    default:
+      break;
+  }
 
-    if (pos + 1 > EJ_STR_MAX) {
-      ej_set_error(buffer, "Key position %c length %zu too long.", c, pos + 1);
-      return false;
-    }
+  return true;
+}
+
+EJ_MODULE_EXPORT(size_t) ej_write_value_size(EJValue *data) {
+  size_t size = 0;
+
+  ej_write_value_size_inner(data, &size);
+  return size;
+}
+
+/* sink */
+#define EJ_SINK_BUFFER_SIZE (64 * 1024)
+
+EJ_MODULE_EXPORT(EJSink*) ej_sink_new(EJSinkWriteFunc write, EJSinkFlushFunc flush, gpointer user_data, size_t buffer_size) {
+  EJSink *sink;
+
+  ej_return_val_if_fail(write != NULL, NULL);
+
+  if (buffer_size == 0) { buffer_size = EJ_SINK_BUFFER_SIZE; }
+  /* a number is formatted in place */
+  buffer_size = MAX(buffer_size, EJ_NUMBER_TEXT_SIZE);
+  sink = ej_new0(EJSink, 1);
+  ej_sink_init(sink, write, flush, user_data, ej_malloc(buffer_size), buffer_size);
+
+  return sink;
+}
+
+static EJBool ej_sink_file_write(const EJString *data, size_t len, gpointer user_data) {
+  return fwrite(data, 1, len, (FILE *)user_data) == len;
+}
+
+static EJBool ej_sink_file_flush(gpointer user_data) {
+  return fflush((FILE *)user_data) == 0;
+}
+
+EJ_MODULE_EXPORT(EJSink*) ej_sink_file_new(FILE *file, size_t buffer_size) {
+  ej_return_val_if_fail(file != NULL, NULL);
+  return ej_sink_new(ej_sink_file_write, ej_sink_file_flush, file, buffer_size);
+}
+
+static EJBool ej_sink_fd_write(const EJString *data, size_t len, gpointer user_data) {
+  int fd = GPOINTER_TO_INT(user_data);
+  gssize n;
+
+  while (len > 0) {
+    n = ej_fd_write(fd, data, len);
+    if (n < 0 && errno == EINTR) { continue; }
+    if (n <= 0) { return false; }
+
+    data += n;
+    len -= (size_t)n;
   }
-  if (pos == 0) { return false; }
 
-  *data = ej_strndup(ej_read_inner(buffer, 0), pos);
-  ej_buffer_skip(buffer, pos);
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJSink*) ej_sink_fd_new(int fd, size_t buffer_size) {
+  ej_return_val_if_fail(fd >= 0, NULL);
+  return ej_sink_new(ej_sink_fd_write, NULL, GINT_TO_POINTER(fd), buffer_size);
+}
+
+static EJBool ej_sink_stream_write(const EJString *data, size_t len, gpointer user_data) {
+  return g_output_stream_write_all((GOutputStream *)user_data, data, len, NULL, NULL, NULL);
+}
+
+static EJBool ej_sink_stream_flush(gpointer user_data) {
+  return g_output_stream_flush((GOutputStream *)user_data, NULL, NULL);
+}
+
+EJ_MODULE_EXPORT(EJSink*) ej_sink_stream_new(GOutputStream *stream, size_t buffer_size) {
+  ej_return_val_if_fail(stream != NULL, NULL);
+  return ej_sink_new(ej_sink_stream_write, ej_sink_stream_flush, stream, buffer_size);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_sink_write_value(EJSink *sink, EJValue *data) {
+  ej_return_val_if_fail(sink != NULL, false);
+
+  if (!ej_write_value_inner(data, sink)) {
+    return false;
+  }
+
+  return !sink->failed;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_sink_write(EJSink *sink, const EJString *data, size_t len) {
+  ej_return_val_if_fail(sink != NULL, false);
+
+  ej_sink_append(sink, data, len);
+  return !sink->failed;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_sink_flush(EJSink *sink) {
+  ej_return_val_if_fail(sink != NULL, false);
+
+  if (!ej_sink_drain(sink)) {
+    return false;
+  }
+  if (sink->flush && !sink->flush(sink->user_data)) {
+    sink->failed = true;
+  }
+
+  return !sink->failed;
+}
+
+EJ_MODULE_EXPORT(void) ej_sink_free(EJSink *sink) {
+  if (!sink) { return; }
+
+  ej_free(sink->data);
+  ej_free(sink);
+}
+
+/* the print functions return what the writers append to an empty string */
+EJ_MODULE_EXPORT(EJBool) ej_print_number(EJNumber *data, EJString **buffer) {
+  GString *value = ej_string_new("");
+
+  EJ_WRITE_STRING(value, ej_write_number(data, &sink));
+  *buffer = value->str; ej_string_free(value, false);
 
   return true;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_parse_key(EJBuffer *buffer, EJValue **data) {
-  if (!ej_skip_whitespace(buffer)) { return false; }
-  if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) { return false; }
+EJ_MODULE_EXPORT(EJBool) ej_print_bool(EJBool data, EJString **buffer) {
+  *buffer = data ? ej_strdup("true"): ej_strdup("false");
+  return true;
+}
 
-  EJValue *kv;
+EJ_MODULE_EXPORT(EJBool) ej_print_array_value(size_t arrlen, size_t index, EJValue *data, EJString **buffer) {
+  GString *value;
 
-  kv = ej_new0(EJValue, 1);
-  if (*ej_read_inner(buffer, 0) == '@') {
-    ej_buffer_skip(buffer, 1);
+  ej_assert(index < arrlen);
 
-    kv->type = EJ_EOBJECT;
-    if (ej_parse_object(buffer, &kv->v.object)) {
-      goto success;
-    }
+  value = ej_string_new("");
+  ej_write_value(data, value);
+
+  if (index + 1 < arrlen) {
+    ej_string_append_c(value, ',');
   }
+  *buffer = value->str; ej_string_free(value, false);
+
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_print_array(EJArray *data, EJString **buffer) {
+  GString *value;
+
+  if (!data) { return false; }
+
+  value = ej_string_new("");
+  EJ_WRITE_STRING(value, ej_write_array(data, &sink));
+  *buffer = value->str; ej_string_free(value, false);
+
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_print_object_pair_prop(EJArray *data, EJString **buffer) {
+  GString *value;
+
+  if (!data) { return false; }
+
+  value = ej_string_new("");
+  EJ_WRITE_STRING(value, ej_write_object_pair_prop(data, &sink));
+  *buffer = value->str; ej_string_free(value, false);
+
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_print_object_pair(EJObjectPair *data, EJString **buffer) {
+  GString *value;
+
+  if (!ej_object_pair_writable(data)) {
+    return false;
+  }
+
+  value = ej_string_new("");
+  EJ_WRITE_STRING(value, ej_write_object_pair(data, &sink));
+  *buffer = value->str; ej_string_free(value, false);
+
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_print_object(EJObject *data, EJString **buffer) {
+  GString *value;
+
+  if (!data) { return false; }
+
+  value = ej_string_new("");
+  EJ_WRITE_STRING(value, ej_write_object(data, &sink));
+  *buffer = value->str; ej_string_free(value, false);
+
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_print_value(EJValue *data, EJString **buffer) {
+  GString *value;
+
+  if (!ej_value_writable(data)) {
+    return false;
+  }
+
+  value = ej_string_new("");
+  ej_write_value(data, value);
+  *buffer = value->str; ej_string_free(value, false);
+
+  return true;
+}
+
+/* parse */
+EJ_MODULE_EXPORT(EJBool) ej_parse_bool(EJBuffer *buffer, EJBool *data) {
+  ej_return_val_if_fail(data != NULL, false);
+
+  if (ej_token_is(buffer, EJ_TOKEN_FALSE)) {
+    *data = false;
+  }
+  else if (ej_token_is(buffer, EJ_TOKEN_TRUE)) {
+    *data = true;
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+
+/* the 4 hex digits of the \u escape at p, which has len bytes */
+static EJBool ej_read_hex4(const EJString *p, size_t len, gunichar *value) {
+  gint i, digit;
+
+  if (len < 6 || p[0] != '\\' || p[1] != 'u') { return false; }
+
+  *value = 0;
+  for (i = 2; i < 6; i++) {
+    digit = ej_ascii_xdigit_value(p[i]);
+    if (digit < 0) { return false; }
+    *value = (*value << 4) | (gunichar)digit;
+  }
+
+  return true;
+}
+
+/* the code point of the \u escape at p, which has len bytes, a surrogate pair
+ * is one escape. returns its length, 0 when it is not valid. \u0000 is not
+ * valid either, the decoded strings are terminated. */
+static size_t ej_read_unicode_escape(const EJString *p, size_t len, gunichar *cp) {
+  gunichar high, low;
+
+  if (!ej_read_hex4(p, len, &high) || high == 0 || (high >= 0xDC00 && high <= 0xDFFF)) { return 0; }
+  if (high < 0xD800 || high > 0xDBFF) {
+    *cp = high;
+    return 6;
+  }
+
+  if (!ej_read_hex4(p + 6, len - 6, &low) || low < 0xDC00 || low > 0xDFFF) { return 0; }
+  *cp = 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+  return 12;
+}
+
+/* decode the len escaped bytes of data into ndata, ndata may be data itself
+ * because the decoded string is never longer than the escaped one. */
+static EJString *ej_remove_escaped_string(EJString *ndata, const EJString *data, size_t len) {
+  ej_assert(ndata != NULL && data != NULL);
+
+  size_t i = 0, j = 0, elen;
+  EJString c, n;
+  gunichar cp;
+
+  while(i < len) {
+    c = *(data + i);
+    if (c == '\0') { break; }
+
+    if (c == '\\') {
+      i += 1;
+      n = *(data + i);
+
+      switch (n)
+      {
+      case 'b':
+        c = '\b';
+        break;
+      case 'f':
+        c = '\f';
+        break;
+      case 'n':
+        c = '\n';
+        break;
+      case 'r':
+        c = '\r';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      case '\"':
+        c = '\"';
+        break;
+      case '\\':
+        c = '\\';
+        break;
+      case 'u':
+        /* every byte of the escape is read before the code point is written */
+        elen = ej_read_unicode_escape(data + i - 1, len - i + 1, &cp);
+        if (elen == 0) { goto fail; }
+
+        j += ej_unichar_to_utf8(cp, ndata + j);
+        i += elen - 1;
+        continue;
+      case '/':
+        c = '/';
+        break;
+      default:
+        goto fail;
+      }
+    }
+
+    *(ndata + j) = c;
+    j += 1;
+    i += 1;
+  }
+
+  ndata[j] = '\0';
+  return ndata;
+
+fail:
+  return NULL;
+}
+
+/* skip the opening quote and measure the string, skip counts the escapes */
+static EJBool ej_scan_string(EJBuffer *buffer, size_t *length, size_t *escapes) {
+  size_t len = 0, elen;
+  EJString c, n;
+  size_t skip = 0;
+  gunichar cp;
+
+  ej_buffer_skip(buffer, 1);
+
+  len = 0;
+  while (true) {
+    c = ej_read_c_inner(buffer, (int)len);
+    if (c == '\0') { ej_set_error(buffer, "occur buffer end when parse string"); return false; }
+
+    if (c == '\\') {
+      n = ej_read_c_inner(buffer, (int)len + 1);
+      skip += 1;
+
+      switch (n)
+      {
+      case 'b':
+        break;
+      case 'f':
+        break;
+      case 'n':
+        break;
+      case 'r':
+        break;
+      case 't':
+        break;
+      case '\"':
+      case '\\':
+      case '/':
+        len = len + 1;
+        break;
+      case 'u':
+        elen = ej_read_unicode_escape(ej_read_inner(buffer, (int)len), buffer->length - buffer->offset - len, &cp);
+        if (elen == 0) {
+          ej_set_error(buffer, "occur invalid unicode escape when parse string");
+          return false;
+        }
+        len = len + elen - 1;
+        break;
+      default:
+        ej_set_error(buffer, "occur not support escaped char %c when parse string", n);
+        return false;
+      }
+    }
+
+    if (c == '\"' || len + 1 > EJ_STR_MAX) {
+      break;
+    }
+
+    len++;
+  }
+
+  *length = len;
+  *escapes = skip;
+  return true;
+}
+
+/* copy or decode the len bytes of a scanned string body */
+static EJBool ej_decode_string(EJBuffer *buffer, const EJString *sdata, size_t len, EJBool escaped,
+  EJString **data, EJ_VALUE_FLAGS *flags, EJBool key) {
+  EJString *ndata;
+  EJBool intern = key && buffer->keys != NULL && flags != NULL;
+  /* only a caller with flags can be told the string is borrowed */
+  EJBool insitu = buffer->insitu && flags != NULL;
+
+  if (intern && !escaped) {
+    *data = (EJString *)ej_key_table_intern_len(buffer->keys, sdata, len);
+    *flags |= EJ_VALUE_FLAG_BORROWED | EJ_VALUE_FLAG_INTERNED;
+    return true;
+  }
+
+  if (insitu) {
+    /* the closing quote becomes the terminator */
+    ndata = (EJString *)sdata;
+  }
+  else {
+    ndata = ej_buffer_string_new(buffer, len);
+  }
+
+  if (!escaped) {
+    if (ndata != sdata) { memcpy(ndata, sdata, len); }
+    ndata[len] = '\0';
+    *data = ndata;
+  }
+  else {
+    *data = ej_remove_escaped_string(ndata, sdata, len);
+  }
+
+  if(*data == NULL) {
+    if (!insitu && buffer->arena == NULL) { ej_free(ndata); }
+    goto fail;
+  }
+
+  if (intern) {
+    *data = (EJString *)ej_key_table_intern(buffer->keys, *data);
+    if (!insitu && buffer->arena == NULL) { ej_free(ndata); }
+    *flags |= EJ_VALUE_FLAG_BORROWED | EJ_VALUE_FLAG_INTERNED;
+  }
+  else if (insitu) {
+    *flags |= EJ_VALUE_FLAG_BORROWED;
+  }
+
+  return true;
+
+fail:
+  ej_set_error(buffer, "Parse string failed");
+  return false;
+}
+
+static EJBool ej_parse_string_inner(EJBuffer *buffer, EJString **data, EJ_VALUE_FLAGS *flags, EJBool key) {
+  size_t len, skip;
+
+  if (!ej_scan_string(buffer, &len, &skip)) { return false; }
+  if (!ej_decode_string(buffer, ej_read_inner(buffer, 0), len, skip > 0, data, flags, key)) { return false; }
+
+  ej_buffer_skip(buffer, len + 1);
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_string(EJBuffer *buffer, EJString **data) {
+  if (!ej_token_is(buffer, EJ_TOKEN_QMARK)) {
+    return false;
+  }
+
+  return ej_parse_string_inner(buffer, data, NULL, false);
+}
+
+/* length of the unquoted key right at the offset, 0 when there is none */
+static size_t ej_scan_key_bare(EJBuffer *buffer) {
+  const EJString *p;
+  size_t pos, len;
+
+  if (buffer->offset >= buffer->length) { return 0; }
+
+  p = ej_read_inner(buffer, 0);
+  len = MIN(buffer->length - buffer->offset, (size_t)EJ_STR_MAX + 1);
+  for (pos = 0; pos < len && ej_is_key_char(p[pos]); pos++);
+
+  if (pos == 0 && p[0] != '\0') {
+    ej_set_error(buffer, "Key length cannot be zero.");
+    return 0;
+  }
+  if (pos > EJ_STR_MAX) {
+    ej_set_error(buffer, "Key position %c length %zu too long.", p[EJ_STR_MAX], (size_t)EJ_STR_MAX + 1);
+    return 0;
+  }
+
+  return pos;
+}
+
+/* length of the unquoted key at the offset, 0 when there is none */
+static size_t ej_scan_key_without_quote(EJBuffer *buffer) {
+  /* a comment right at the offset is skipped, as ej_read_c does */
+  ej_comment(buffer);
+
+  return ej_scan_key_bare(buffer);
+}
+
+/* the unquoted key of pos bytes at the offset, interned as in ej_decode_string
+ * only for a caller with flags */
+static EJBool ej_take_key_without_quote(EJBuffer *buffer, size_t pos, EJString **data, EJ_VALUE_FLAGS *flags) {
+  if (pos == 0) { return false; }
+
+  if (buffer->keys != NULL && flags != NULL) {
+    *data = (EJString *)ej_key_table_intern_len(buffer->keys, ej_read_inner(buffer, 0), pos);
+    *flags |= EJ_VALUE_FLAG_BORROWED | EJ_VALUE_FLAG_INTERNED;
+  }
+  else {
+    *data = ej_buffer_strndup(buffer, ej_read_inner(buffer, 0), pos);
+  }
+  ej_buffer_skip(buffer, pos);
+
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_key_without_quote(EJBuffer *buffer, EJString **data) {
+  return ej_take_key_without_quote(buffer, ej_scan_key_without_quote(buffer), data, NULL);
+}
+
+#define EJ_NUMBER_MAX_DIGITS 19
+#define EJ_NUMBER_MAX_EXPONENT 100000
+#define EJ_NUMBER_STACK_SIZE 64
+
+static const double EJ_POW10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int ej_clz64(guint64 value) {
+#if _MSC_VER && defined(_M_X64)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return 63 - (int)index;
+#elif _MSC_VER
+  unsigned long index;
+  if (_BitScanReverse(&index, (unsigned long)(value >> 32))) { return 31 - (int)index; }
+  _BitScanReverse(&index, (unsigned long)value);
+  return 63 - (int)index;
+#else
+  return __builtin_clzll(value);
+#endif
+}
+
+static inline guint64 ej_mul128(guint64 a, guint64 b, guint64 *high) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 r = (unsigned __int128)a * b;
+  *high = (guint64)(r >> 64);
+  return (guint64)r;
+#elif _MSC_VER && defined(_M_X64)
+  return _umul128(a, b, high);
+#else
+  guint64 a_lo = (guint32)a, a_hi = a >> 32;
+  guint64 b_lo = (guint32)b, b_hi = b >> 32;
+  guint64 lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+  guint64 lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+  guint64 cross = (lo_lo >> 32) + (guint32)hi_lo + lo_hi;
+  *high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+  return (cross << 32) | (guint32)lo_lo;
+#endif
+}
+
+/* eight ascii digits at once, the chunk is read little endian */
+static inline guint64 ej_read_8digits(const EJString *p) {
+  guint64 value;
+  memcpy(&value, p, sizeof(value));
+  return GUINT64_FROM_LE(value);
+}
+
+static inline EJBool ej_is_8digits(guint64 value) {
+  return (((value & 0xF0F0F0F0F0F0F0F0ULL)
+    | (((value + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL);
+}
+
+static inline guint32 ej_parse_8digits(guint64 value) {
+  value -= 0x3030303030303030ULL;
+  value = (value * 10) + (value >> 8);
+  value = (((value & 0x000000FF000000FFULL) * 0x000F424000000064ULL)
+    + (((value >> 16) & 0x000000FF000000FFULL) * 0x0000271000000001ULL)) >> 32;
+  return (guint32)value;
+}
+
+/* Eisel-Lemire, mantissa * 10^exponent rounded to nearest even.
+ * Returns false when the truncated product can't decide the rounding. */
+static EJBool ej_number_eisel_lemire(guint64 mantissa, gint64 exponent, EJBool negative, double *data) {
+  guint64 low, high, second_high, bits;
+  gint64 power2;
+  int lz, upperbit;
+  size_t index;
+
+  if (exponent < EJ_POW5_MIN || exponent > EJ_POW5_MAX) { return false; }
+
+  lz = ej_clz64(mantissa);
+  mantissa <<= lz;
+
+  index = 2 * (size_t)(exponent - EJ_POW5_MIN);
+  low = ej_mul128(mantissa, EJ_POW5_128[index], &high);
+  if ((high & 0x1FF) == 0x1FF) {
+    ej_mul128(mantissa, EJ_POW5_128[index + 1], &second_high);
+    low += second_high;
+    if (second_high > low) { high++; }
+    if (low == 0xFFFFFFFFFFFFFFFFULL) { return false; }
+  }
+
+  upperbit = (int)(high >> 63);
+  bits = high >> (upperbit + 9);
+  lz += 1 ^ upperbit;
+  /* floor(log2(5^q)) + q, plus the bias and the word size */
+  power2 = (((152170 + 65536) * exponent) >> 16) + 1024 + 63 - lz;
+
+  if (power2 <= 0) {
+    if (-power2 + 1 >= 64) {
+      bits = 0;
+      power2 = 0;
+    }
+    else {
+      bits >>= -power2 + 1;
+      bits += bits & 1;
+      bits >>= 1;
+      power2 = (bits < (1ULL << 52)) ? 0 : 1;
+      bits &= ~(1ULL << 52);
+    }
+    goto success;
+  }
+
+  /* exactly between two doubles, round to even instead of up */
+  if (low <= 1 && exponent >= -4 && exponent <= 23 && (bits & 3) == 1
+    && (bits << (upperbit + 9)) == high) {
+    bits &= ~1ULL;
+  }
+
+  bits += bits & 1;
+  bits >>= 1;
+  if (bits >= (1ULL << 53)) {
+    bits = 1ULL << 52;
+    power2++;
+  }
+  bits &= ~(1ULL << 52);
+  if (power2 > 2046) { return false; }
+
+success:
+  bits |= ((guint64)power2 << 52) | ((guint64)(negative ? 1 : 0) << 63);
+  memcpy(data, &bits, sizeof(*data));
+  return true;
+}
+
+static double ej_number_to_double(const EJString *str, size_t len, guint64 mantissa, gint64 exponent, EJBool negative, EJBool exact) {
+  EJString stack[EJ_NUMBER_STACK_SIZE];
+  EJString *nstr;
+  double d;
+
+  if (exact) {
+    if (mantissa == 0) { return negative ? -0.0 : 0.0; }
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+    /* both operands are exact doubles, so is the correctly rounded result */
+    if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+      d = (double)mantissa;
+      d = exponent < 0 ? d / EJ_POW10[-exponent] : d * EJ_POW10[exponent];
+      return negative ? -d : d;
+    }
+#endif
+    if (ej_number_eisel_lemire(mantissa, exponent, negative, &d)) { return d; }
+  }
+
+  if (len < EJ_NUMBER_STACK_SIZE) {
+    memcpy(stack, str, len);
+    stack[len] = '\0';
+    return ej_ascii_strtod(stack, NULL);
+  }
+
+  nstr = ej_strndup(str, len);
+  d = ej_ascii_strtod(nstr, NULL);
+  ej_free(nstr);
+  return d;
+}
+
+/* number text, integers two digits at a time and doubles as the fewest
+ * digits which parse back to the same value (Schubfach, R. Giulietti) */
+static const char EJ_DIGIT_PAIRS[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/* the digits of v are written backwards from end, returns the first one */
+static EJString *ej_format_digits(guint64 v, EJString *end) {
+  const char *pair;
+
+  while (v >= 100) {
+    pair = EJ_DIGIT_PAIRS + 2 * (v % 100);
+    v /= 100;
+    *--end = pair[1];
+    *--end = pair[0];
+  }
+  if (v >= 10) {
+    pair = EJ_DIGIT_PAIRS + 2 * v;
+    *--end = pair[1];
+    *--end = pair[0];
+  }
+  else {
+    *--end = (EJString)('0' + v);
+  }
+
+  return end;
+}
+
+static size_t ej_format_int(int v, EJString *text) {
+  EJString digits[20], *end = digits + sizeof(digits), *start;
+  size_t len = 0;
+
+  start = ej_format_digits(v < 0 ? (guint64)(-(gint64)v) : (guint64)v, end);
+  if (v < 0) { text[len++] = '-'; }
+  memcpy(text + len, start, (size_t)(end - start));
+
+  return len + (size_t)(end - start);
+}
+
+/* floor(10^k * 2^-r) + 1 for the r which puts it into [2^127, 2^128) */
+static void ej_pow10_significand(int k, guint64 *hi, guint64 *lo) {
+  size_t index = 2 * (size_t)(k - EJ_POW5_MIN);
+
+  *hi = EJ_POW5_128[index];
+  *lo = EJ_POW5_128[index + 1];
+  /* the ones which are rounded up already */
+  if (k < -27 || k >= 0) {
+    *lo += 1;
+    *hi += *lo == 0;
+  }
+}
+
+/* the high 64 bits of g * cp, rounded to odd */
+static guint64 ej_round_to_odd(guint64 g_hi, guint64 g_lo, guint64 cp) {
+  guint64 x_hi, y_hi, y_lo;
+
+  ej_mul128(g_lo, cp, &x_hi);
+  y_lo = ej_mul128(g_hi, cp, &y_hi);
+  y_lo += x_hi;
+  y_hi += y_lo < x_hi;
+
+  return y_hi | (y_lo > 1);
+}
+
+/* floor(x / 2^p) */
+#define ej_floor_shift(x, p) ((x) >= 0 ? (x) >> (p) : ~(~(x) >> (p)))
+
+/* a finite positive double is digits * 10^exponent */
+static void ej_double_to_decimal(guint64 bits, guint64 *digits, int *exponent) {
+  guint64 significand = bits & ((1ULL << 52) - 1);
+  int biased = (int)((bits >> 52) & 0x7FF);
+  guint64 c, cbl, cb, cbr, vbl, vb, vbr, lower, upper, s, sp, g_hi, g_lo;
+  int q, k, h;
+  EJBool even, closer, u_inside, w_inside;
+
+  if (biased != 0) {
+    c = (1ULL << 52) | significand;
+    q = biased - 1075;
+    /* integers below 2^53 are their own digits */
+    if (q <= 0 && q > -53 && (c & ((1ULL << -q) - 1)) == 0) {
+      s = c >> -q;
+      k = 0;
+      goto done;
+    }
+  }
+  else {
+    c = significand;
+    q = 1 - 1075;
+  }
+
+  even = (c & 1) == 0;
+  closer = significand == 0 && biased > 1;
+  cbl = 4 * c - 2 + closer;
+  cb = 4 * c;
+  cbr = 4 * c + 2;
+
+  /* floor(log10(2^q)), or of 3/4 2^q when the lower neighbour is closer */
+  k = ej_floor_shift(q * 1262611 - (closer ? 524031 : 0), 22);
+  /* q + floor(log2(10^-k)) + 1 */
+  h = q + ej_floor_shift(-k * 1741647, 19) + 1;
+
+  ej_pow10_significand(-k, &g_hi, &g_lo);
+  vbl = ej_round_to_odd(g_hi, g_lo, cbl << h);
+  vb = ej_round_to_odd(g_hi, g_lo, cb << h);
+  vbr = ej_round_to_odd(g_hi, g_lo, cbr << h);
+  lower = vbl + !even;
+  upper = vbr - !even;
+
+  s = vb / 4;
+  if (s >= 10) {
+    /* one digit less, at most one of the two candidates is in range */
+    sp = s / 10;
+    u_inside = lower <= 40 * sp;
+    w_inside = 40 * sp + 40 <= upper;
+    if (u_inside != w_inside) {
+      s = sp + w_inside;
+      k++;
+      goto done;
+    }
+  }
+
+  u_inside = lower <= 4 * s;
+  w_inside = 4 * s + 4 <= upper;
+  if (u_inside != w_inside) {
+    s += w_inside;
+    goto done;
+  }
+
+  /* both are in range, the closer one, the even one on a tie */
+  s += vb > 4 * s + 2 || (vb == 4 * s + 2 && (s & 1) != 0);
+
+done:
+  while (s % 10 == 0) {
+    s /= 10;
+    k++;
+  }
+  *digits = s;
+  *exponent = k;
+}
+
+/* always with a '.' or an exponent so it parses back as EJ_DOUBLE, "null"
+ * for nan and infinities which json has no text for */
+static size_t ej_format_double(double d, EJString *text) {
+  EJString buffer[20], *end = buffer + sizeof(buffer), *start;
+  guint64 bits, digits;
+  int exponent, n, point;
+  size_t len = 0;
+
+  memcpy(&bits, &d, sizeof(bits));
+  if (((bits >> 52) & 0x7FF) == 0x7FF) {
+    memcpy(text, "null", 4);
+    return 4;
+  }
+
+  if (bits >> 63) { text[len++] = '-'; }
+  bits &= ~(1ULL << 63);
+  if (bits == 0) {
+    memcpy(text + len, "0.0", 3);
+    return len + 3;
+  }
+
+  ej_double_to_decimal(bits, &digits, &exponent);
+  start = ej_format_digits(digits, end);
+  n = (int)(end - start);
+  /* the position of the point after the first digit, 1.5e3 has 4 */
+  point = exponent + n;
+
+  if (point > 16 || point < -3) {
+    /* 1.5e-7, 1e21 */
+    text[len++] = start[0];
+    if (n > 1) {
+      text[len++] = '.';
+      memcpy(text + len, start + 1, (size_t)(n - 1));
+      len += (size_t)(n - 1);
+    }
+    text[len++] = 'e';
+    if (point < 1) { text[len++] = '-'; }
+    start = ej_format_digits((guint64)(point < 1 ? 1 - point : point - 1), end);
+    memcpy(text + len, start, (size_t)(end - start));
+    len += (size_t)(end - start);
+  }
+  else if (point <= 0) {
+    /* 0.0015 */
+    text[len++] = '0';
+    text[len++] = '.';
+    memset(text + len, '0', (size_t)-point);
+    len += (size_t)-point;
+    memcpy(text + len, start, (size_t)n);
+    len += (size_t)n;
+  }
+  else if (point >= n) {
+    /* 1500.0 */
+    memcpy(text + len, start, (size_t)n);
+    len += (size_t)n;
+    memset(text + len, '0', (size_t)(point - n));
+    len += (size_t)(point - n);
+    memcpy(text + len, ".0", 2);
+    len += 2;
+  }
+  else {
+    /* 1.5 */
+    memcpy(text + len, start, (size_t)point);
+    len += (size_t)point;
+    text[len++] = '.';
+    memcpy(text + len, start + point, (size_t)(n - point));
+    len += (size_t)(n - point);
+  }
+
+  return len;
+}
+
+EJ_MODULE_EXPORT(size_t) ej_format_number(EJNumber *data, EJString *text) {
+  switch (data->type)
+  {
+    case EJ_INT:
+      return ej_format_int(data->v.i, text);
+    case EJ_DOUBLE:
+      return ej_format_double(data->v.d, text);
+    default:
+      return 0;
+  }
+}
+
+static EJBool ej_scan_number(EJBuffer *buffer, EJNumber *num) {
+  const EJString *start = ej_read_inner(buffer, 0);
+  const EJString *end = buffer->content + buffer->length;
+  const EJString *p = start;
+  guint64 mantissa = 0;
+  gint64 exponent = 0, exp_value = 0;
+  int digits = 0;
+  EJBool negative = false, exp_negative = false;
+  /* a non zero digit didn't fit into the mantissa */
+  EJBool exact = true;
+  EJ_NUMBER_TYPE type = EJ_INT;
+
+  if (p < end && *p == '-') {
+    negative = true;
+    p++;
+  }
+  if (p >= end || !ej_ascii_isdigit(*p)) { goto fail; }
+
+  if (*p == '0') {
+    p++;
+  }
+  else {
+    while (p < end && ej_ascii_isdigit(*p)) {
+      if (digits + 8 <= EJ_NUMBER_MAX_DIGITS && p + 8 <= end && ej_is_8digits(ej_read_8digits(p))) {
+        mantissa = mantissa * 100000000 + ej_parse_8digits(ej_read_8digits(p));
+        digits += 8;
+        p += 8;
+        continue;
+      }
+      if (digits < EJ_NUMBER_MAX_DIGITS) {
+        mantissa = mantissa * 10 + (guint64)(*p - '0');
+        digits++;
+      }
+      else {
+        if (*p != '0') { exact = false; }
+        exponent++;
+      }
+      p++;
+    }
+  }
+
+  if (p < end && *p == '.') {
+    type = EJ_DOUBLE;
+    p++;
+    if (p >= end || !ej_ascii_isdigit(*p)) { goto fail; }
+    while (p < end && ej_ascii_isdigit(*p)) {
+      if (mantissa != 0 && digits + 8 <= EJ_NUMBER_MAX_DIGITS && p + 8 <= end && ej_is_8digits(ej_read_8digits(p))) {
+        mantissa = mantissa * 100000000 + ej_parse_8digits(ej_read_8digits(p));
+        digits += 8;
+        exponent -= 8;
+        p += 8;
+        continue;
+      }
+      if (digits < EJ_NUMBER_MAX_DIGITS) {
+        mantissa = mantissa * 10 + (guint64)(*p - '0');
+        /* leading zeros of the fraction aren't significant */
+        if (mantissa != 0) { digits++; }
+        exponent--;
+      }
+      else if (*p != '0') {
+        exact = false;
+      }
+      p++;
+    }
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    type = EJ_DOUBLE;
+    p++;
+    if (p < end && (*p == '+' || *p == '-')) {
+      exp_negative = (*p == '-');
+      p++;
+    }
+    if (p >= end || !ej_ascii_isdigit(*p)) { goto fail; }
+    while (p < end && ej_ascii_isdigit(*p)) {
+      if (exp_value < EJ_NUMBER_MAX_EXPONENT) {
+        exp_value = exp_value * 10 + (*p - '0');
+      }
+      p++;
+    }
+    exponent += exp_negative ? -exp_value : exp_value;
+  }
+
+  /* 01, 1.2.3, 1-2 */
+  if (p < end && (ej_ascii_isdigit(*p) || *p == '.' || *p == '+' || *p == '-' || *p == 'e' || *p == 'E')) {
+    goto fail;
+  }
+
+  if (type == EJ_INT && (exponent != 0 || mantissa > (guint64)G_MAXINT + (negative ? 1 : 0))) {
+    type = EJ_DOUBLE;
+  }
+
+  num->type = type;
+  if (type == EJ_INT) {
+    num->v.i = negative ? (int)(-(gint64)mantissa) : (int)mantissa;
+  }
+  else {
+    num->v.d = ej_number_to_double(start, (size_t)(p - start), mantissa, exponent, negative, exact);
+  }
+  ej_buffer_skip(buffer, (size_t)(p - start));
+
+  return true;
+fail:
+  ej_set_error(buffer, "Parse number failed");
+  return false;
+}
+
+static EJBool ej_parse_number_inner(EJBuffer *buffer, EJNumber **data) {
+  EJNumber num;
+
+  if (!ej_scan_number(buffer, &num)) { return false; }
+
+  *data = ej_buffer_new0(buffer, EJNumber, 1);
+  **data = num;
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_number(EJBuffer *buffer, EJNumber **data) {
+  if (!ej_token_is(buffer, EJ_TOKEN_HYPHEN) && !ej_ascii_isdigit(ej_read_c_inner(buffer, 0))) {
+    return false;
+  }
+
+  return ej_parse_number_inner(buffer, data);
+}
+
+/* dialects, the recursive parser is written once against a constant options
+ * set and inlined into one function per common set, so a feature that is off
+ * costs no check. other sets go through a copy reading buffer->options. */
+static EJBool ej_parse_value_strict(EJBuffer *buffer, EJValue **data);
+static EJBool ej_parse_value_jsonc(EJBuffer *buffer, EJValue **data);
+static EJBool ej_parse_value_extended(EJBuffer *buffer, EJValue **data);
+static EJBool ej_parse_value_generic(EJBuffer *buffer, EJValue **data);
+static EJBool ej_parse_props_strict(EJBuffer *buffer, EJObject *object, EJArray **data);
+static EJBool ej_parse_props_jsonc(EJBuffer *buffer, EJObject *object, EJArray **data);
+static EJBool ej_parse_props_extended(EJBuffer *buffer, EJObject *object, EJArray **data);
+static EJBool ej_parse_props_generic(EJBuffer *buffer, EJObject *object, EJArray **data);
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_call_value(EJBuffer *buffer, EJValue **data, const EJParseOptions options) {
+  switch (options) {
+    case EJ_PARSE_STRICT:
+      return ej_parse_value_strict(buffer, data);
+    case EJ_PARSE_JSONC:
+      return ej_parse_value_jsonc(buffer, data);
+    case EJ_PARSE_EXTENDED:
+      return ej_parse_value_extended(buffer, data);
+    default:
+      return ej_parse_value_generic(buffer, data);
+  }
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_call_props(EJBuffer *buffer, EJObject *object, EJArray **data,
+                                                     const EJParseOptions options) {
+  switch (options) {
+    case EJ_PARSE_STRICT:
+      return ej_parse_props_strict(buffer, object, data);
+    case EJ_PARSE_JSONC:
+      return ej_parse_props_jsonc(buffer, object, data);
+    case EJ_PARSE_EXTENDED:
+      return ej_parse_props_extended(buffer, object, data);
+    default:
+      return ej_parse_props_generic(buffer, object, data);
+  }
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_skip_whitespace(EJBuffer *buffer, const EJParseOptions options) {
+  size_t end;
+
+  if (options & EJ_PARSE_COMMENTS) {
+    return ej_skip_whitespace(buffer);
+  }
+
+  end = ej_scan_whitespace(buffer->content, buffer->offset, buffer->length);
+  ej_buffer_advance(buffer, end - buffer->offset);
+
+  return ej_read_c_inner(buffer, 0) != '\0';
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_ensure_char(EJBuffer *buffer, EJ_TOKEN_TYPE ch, const EJParseOptions options) {
+  return ej_dialect_skip_whitespace(buffer, options) && ej_token_is(buffer, ch);
+}
+
+/* a ',' was just skipped and the closing token follows */
+static EJ_ALWAYS_INLINE EJBool ej_dialect_trailing_comma(EJBuffer *buffer, const EJParseOptions options) {
+  if (options & EJ_PARSE_TRAILING_COMMAS) { return true; }
+
+  ej_set_error(buffer, "Trailing comma is not allowed");
+  return false;
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_key(EJBuffer *buffer, EJValue **data, const EJParseOptions options) {
+  EJValue *kv;
+  size_t pos;
+
+  if (!ej_dialect_skip_whitespace(buffer, options)) { return false; }
+  if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) { return false; }
+
+  kv = ej_buffer_new0(buffer, EJValue, 1);
+  if ((options & EJ_PARSE_EOBJECTS) && ej_read_c_inner(buffer, 0) == '@') {
+    ej_buffer_skip(buffer, 1);
+
+    kv->type = EJ_EOBJECT;
+    if (ej_parse_object(buffer, &kv->v.object)) {
+      goto success;
+    }
+  }
+
+  if (ej_token_is(buffer, EJ_TOKEN_QMARK) && ej_parse_string_inner(buffer, &kv->v.string, &kv->flags, true)) {
+    kv->type = EJ_STRING;
+    goto success;
+  }
+
+  kv->type = EJ_STRING;
+  if (!(options & EJ_PARSE_BARE_KEYS)) {
+    ej_set_error(buffer, "Key should be a quoted string");
+    goto fail;
+  }
+
+  pos = (options & EJ_PARSE_COMMENTS) ? ej_scan_key_without_quote(buffer) : ej_scan_key_bare(buffer);
+  if (!ej_take_key_without_quote(buffer, pos, &kv->v.string, &kv->flags)) {
+    goto fail;
+  }
+
+  if (!ej_valid(buffer, 1)) {
+    ej_set_error(buffer, "Occour buffer end when parse key.");
+    goto fail;
+  }
+
+success:
+  *data = kv;
+  return true;
+fail:
+  ej_buffer_free_value(buffer, kv);
+  return false;
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_props(EJBuffer *buffer, EJObject *object, EJArray **data,
+                                                const EJParseOptions options) {
+  size_t mark;
+  EJObjectPair *pair = NULL;
+
+  ej_assert(ej_token_is(buffer, EJ_TOKEN_LT));
+  ej_buffer_skip(buffer, 1);
+  if (!ej_dialect_skip_whitespace(buffer, options)) { return false; }
+
+  mark = ej_buffer_stack_mark(buffer);
+  if (ej_dialect_ensure_char(buffer, EJ_TOKEN_GT, options)) {
+    goto success;
+  }
+
+  while (true) {
+    if (!ej_valid(buffer, 1)) {
+      goto fail;
+    }
+
+    pair = ej_buffer_new0(buffer, EJObjectPair, 1);
+    /* parse key */
+    if (!ej_dialect_key(buffer, &pair->key, options)) {
+      ej_buffer_free_object_pair(buffer, pair);
+      goto fail;
+    }
+
+    if (!ej_dialect_skip_whitespace(buffer, options)) {
+      ej_buffer_free_object_pair(buffer, pair);
+      goto fail;
+    }
+
+    if (ej_token_is(buffer, EJ_TOKEN_LT)) {
+      if (!ej_dialect_call_props(buffer, object, &pair->props, options)) {
+        ej_buffer_free_object_pair(buffer, pair);
+        ej_set_error(buffer, "Parse property failed");
+        goto fail;
+      }
+    }
+
+    if (!ej_token_is(buffer, EJ_TOKEN_COLON)) {
+      ej_set_error(buffer, "Missing ':' before parse key property value");
+      ej_buffer_free_object_pair(buffer, pair);
+      goto fail;
+    }
+    ej_buffer_skip(buffer, 1);
+
+    /* parse value */
+    if (!ej_dialect_call_value(buffer, &pair->value, options)) {
+      ej_set_error(buffer, "Parse property value failed");
+      ej_buffer_free_object_pair(buffer, pair);
+      goto fail;
+    }
+    ej_buffer_stack_push(buffer, pair);
+
+    if (ej_token_is(buffer, EJ_TOKEN_COMMA)) {
+      ej_buffer_skip(buffer, 1);
+      if (ej_dialect_ensure_char(buffer, EJ_TOKEN_GT, options)) {
+        if (!ej_dialect_trailing_comma(buffer, options)) { goto fail; }
+        break;
+      }
+    } else if (ej_token_is(buffer, EJ_TOKEN_GT)) {
+      break;
+
+    } else {
+      goto fail;
+    }
+  }
+
+success:
+  if (!ej_token_is(buffer, EJ_TOKEN_GT)) {
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+
+  *data = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  return true;
+
+fail:
+  ej_buffer_stack_discard(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  return false;
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_pair(EJBuffer *buffer, EJObject *obj, EJObjectPair **data,
+                                               const EJParseOptions options) {
+  EJObjectPair *pair;
+
+  if (!ej_dialect_skip_whitespace(buffer, options)) { return false; }
+
+  pair = ej_buffer_new0(buffer, EJObjectPair, 1);
+  /* parse key */
+  if (!ej_dialect_key(buffer, &pair->key, options)) {
+    goto fail;
+  }
+
+  if (ej_dialect_ensure_char(buffer, EJ_TOKEN_LT, options)) {
+    if (!(options & EJ_PARSE_PROPS)) {
+      ej_set_error(buffer, "Properties are not allowed");
+      goto fail;
+    }
+    if (!ej_dialect_call_props(buffer, obj, &pair->props, options)) {
+      goto fail;
+    }
+  }
+
+  if (!ej_dialect_ensure_char(buffer, EJ_TOKEN_COLON, options)) {
+    ej_set_error(buffer, "Missing ':' before parse object value");
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+
+  /* parse value */
+  if (!ej_dialect_call_value(buffer, &pair->value, options)) {
+    goto fail;
+  }
+
+  *data = pair;
+  return true;
+fail:
+  ej_buffer_free_object_pair(buffer, pair);
+  return false;
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_array(EJBuffer *buffer, EJArray **data, const EJParseOptions options) {
+  size_t mark;
+  EJValue *value = NULL;
+
+  ej_buffer_skip(buffer, 1);
+
+  mark = ej_buffer_stack_mark(buffer);
+  if (ej_dialect_ensure_char(buffer, EJ_TOKEN_BKT_END, options)) { goto success; }
+
+  while (true) {
+    if (!ej_dialect_call_value(buffer, &value, options)) {
+      goto fail;
+    }
+    ej_buffer_stack_push(buffer, (gpointer)value);
+
+    if (ej_dialect_ensure_char(buffer, EJ_TOKEN_COMMA, options)) {
+      ej_buffer_skip(buffer, 1);
+
+      if (ej_dialect_ensure_char(buffer, EJ_TOKEN_BKT_END, options)) {
+        if (!ej_dialect_trailing_comma(buffer, options)) { goto fail; }
+        break;
+      }
+    } 
+    else if (ej_token_is(buffer, EJ_TOKEN_BKT_END)) {
+      break;
+    }
+    else {
+      goto fail;
+    }
+  }
+
+success:
+  if (!ej_token_is(buffer, EJ_TOKEN_BKT_END)) {
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+
+  *data = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_value);
+  return true;
+fail:
+  ej_set_error(buffer, "Parse array failed");
+  ej_buffer_stack_discard(buffer, mark, (GDestroyNotify)ej_free_value);
+  return false;
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_object(EJBuffer *buffer, EJObject **data, const EJParseOptions options) {
+  size_t mark;
+  EJObjectPair *pair = NULL;
+
+  ej_buffer_skip(buffer, 1);
+  if (!ej_dialect_skip_whitespace(buffer, options)) { return false; }
+
+  mark = ej_buffer_stack_mark(buffer);
+
+  if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+    goto success;
+  }
+
+  while (true) {
+    if (!ej_dialect_pair(buffer, NULL, &pair, options)) {
+      goto fail;
+    }
+
+    if (!ej_dialect_skip_whitespace(buffer, options)) {
+      ej_buffer_free_object_pair(buffer, pair);
+      goto fail;
+    }
+
+    ej_buffer_stack_push(buffer, pair);
+    if (ej_token_is(buffer, EJ_TOKEN_COMMA)) {
+      ej_buffer_skip(buffer, 1);
+
+      if (!ej_dialect_skip_whitespace(buffer, options)) { goto fail; }
+      if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+        if (!ej_dialect_trailing_comma(buffer, options)) { goto fail; }
+        break;
+      }
+    } 
+    else if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+      break;
+
+    } else {
+      ej_set_error(buffer, "Missing ',' before when parse object");
+      goto fail;
+    }
+  }
+
+success:
+  if (!ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+    ej_set_error(buffer, "Not end with } when parse object");
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+
+  *data = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  return true;
+fail:
+  ej_buffer_stack_discard(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+
+  return false;
+}
+
+static EJ_ALWAYS_INLINE EJBool ej_dialect_value(EJBuffer *buffer, EJValue **data, const EJParseOptions options) {
+  EJValue *value;
+
+  if (!ej_dialect_skip_whitespace(buffer, options)) { return false; }
+
+  value = ej_buffer_new0(buffer, EJValue, 1);
+  value->type = ej_lex_value(buffer);
+  if (value->type == EJ_EOBJECT && !(options & EJ_PARSE_EOBJECTS)) {
+    value->type = EJ_INVALID;
+  }
+
+  switch (value->type) {
+    case EJ_BOOLEAN:
+      ej_parse_bool(buffer, &value->v.bvalue);
+      ej_buffer_skip(buffer, (value->v.bvalue ? 4 : 5));
+      break;
+    case EJ_NULL:
+      ej_buffer_skip(buffer, 4);
+      break;
+    case EJ_NUMBER:
+      if (!ej_parse_number_inner(buffer, &value->v.number)) {
+        goto fail;
+      }
+      break;
+    case EJ_STRING:
+      if (!ej_parse_string_inner(buffer, &value->v.string, &value->flags, false)) {
+        goto fail;
+      }
+      break;
+    case EJ_ARRAY:
+      if (!ej_dialect_array(buffer, &value->v.array, options)) {
+        goto fail;
+      }
+      break;
+    case EJ_OBJECT:
+      if (!ej_dialect_object(buffer, &value->v.object, options)) {
+        goto fail;
+      }
+      break;
+    case EJ_EOBJECT:
+      ej_buffer_skip(buffer, 1);
+      ej_dialect_skip_whitespace(buffer, options);
+
+      if (!ej_dialect_object(buffer, &value->v.object, options)) {
+        goto fail;
+      }
+      break;
+    default:
+      ej_set_error(buffer, "Value should starts with '[' or '{' or '\"' or boolean");
+      goto fail;
+  }
+  *data = value;
+  return true;
+fail:
+  ej_set_error(buffer, "Parse value failed");
+  ej_buffer_free_value(buffer, value);
+  return false;
+}
+
+#define EJ_DIALECT_DEFINE(name, options) \
+  static EJBool ej_parse_value_##name(EJBuffer *buffer, EJValue **data) { \
+    return ej_dialect_value(buffer, data, options); \
+  } \
+  static EJBool ej_parse_props_##name(EJBuffer *buffer, EJObject *object, EJArray **data) { \
+    return ej_dialect_props(buffer, object, data, options); \
+  }
+
+EJ_DIALECT_DEFINE(strict, EJ_PARSE_STRICT)
+EJ_DIALECT_DEFINE(jsonc, EJ_PARSE_JSONC)
+EJ_DIALECT_DEFINE(extended, EJ_PARSE_EXTENDED)
+EJ_DIALECT_DEFINE(generic, buffer->options)
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_array(EJBuffer *buffer, EJArray **data) {
+  if (!ej_token_is(buffer, EJ_TOKEN_BKT_START)) {
+    return false;
+  }
+
+  return ej_dialect_array(buffer, data, buffer->options);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_key(EJBuffer *buffer, EJValue **data) {
+  return ej_dialect_key(buffer, data, buffer->options);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_object_props(EJBuffer *buffer, EJObject *object, EJArray **data) {
+  return ej_dialect_call_props(buffer, object, data, buffer->options);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_object_pair(EJBuffer *buffer, EJObject *obj, EJObjectPair **data) {
+  return ej_dialect_pair(buffer, obj, data, buffer->options);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_object(EJBuffer *buffer, EJObject **data) {
+  if (!ej_token_is(buffer, EJ_TOKEN_CUR_START)) {
+    return false;
+  }
+
+  return ej_dialect_object(buffer, data, buffer->options);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_value(EJBuffer *buffer, EJValue **data) {
+  size_t invalid;
+
+  ej_assert(data != NULL && buffer != NULL && buffer->content != NULL);
+
+  /* once, the modes come back here for parts of the document */
+  if (buffer->validate_utf8) {
+    buffer->validate_utf8 = false;
+
+    if (!ej_validate_utf8(buffer->content, buffer->length, &invalid)) {
+      buffer->offset = invalid;
+      ej_set_error(buffer, "Invalid UTF-8");
+      return false;
+    }
+  }
+
+  if (buffer->mode == EJ_MODE_ITERATIVE) {
+    return ej_parse_value_iterative(buffer, data);
+  }
+  if (buffer->mode == EJ_MODE_INDEXED) {
+    return ej_parse_value_indexed(buffer, data);
+  }
+  if (buffer->mode == EJ_MODE_PARALLEL) {
+    return ej_parse_value_parallel(buffer, data);
+  }
+
+  return ej_dialect_call_value(buffer, data, buffer->options);
+}
+
+/* iterative mode, every recursive parse function above is a frame whose state
+ * is the point it resumes at after the frame it called returns */
+static void ej_frame_call(EJBuffer *buffer, EJ_FRAME_TYPE type) {
+  EJFrame *frame;
+
+  if (buffer->n_frames == buffer->size_frames) {
+    buffer->size_frames = buffer->size_frames > 0 ? buffer->size_frames * 2 : 32;
+    buffer->frames = ej_realloc(buffer->frames, sizeof(EJFrame) * buffer->size_frames);
+  }
+
+  frame = &buffer->frames[buffer->n_frames++];
+  frame->type = type;
+  frame->state = 0;
+  frame->mark = 0;
+  frame->data = NULL;
+
+  if (type == EJ_FRAME_ARRAY || type == EJ_FRAME_OBJECT || type == EJ_FRAME_PROPS) {
+    buffer->depth++;
+  }
+}
+
+static void ej_frame_return(EJBuffer *buffer, EJBool *ret, EJBool value) {
+  EJ_FRAME_TYPE type = buffer->frames[--buffer->n_frames].type;
+
+  if (type == EJ_FRAME_ARRAY || type == EJ_FRAME_OBJECT || type == EJ_FRAME_PROPS) {
+    buffer->depth--;
+  }
+  *ret = value;
+}
+
+static EJBool ej_frame_too_deep(EJBuffer *buffer) {
+  if (buffer->max_depth > 0 && buffer->depth > buffer->max_depth) {
+    ej_set_error(buffer, "Exceed max depth %zu", buffer->max_depth);
+    return true;
+  }
+  return false;
+}
+
+/* events, with buffer->handler set the frames report to it instead of building
+ * nodes, no frame has data then and every result stays NULL */
+static EJBool ej_handler_stopped(EJBuffer *buffer) {
+  ej_set_error(buffer, "Stopped by handler");
+  return false;
+}
+
+/* true without a handler, so the tree building frames pass straight through */
+#define EJ_EMIT(buffer, event, ...) \
+  ((buffer)->handler == NULL || (buffer)->handler->event == NULL || \
+   (buffer)->handler->event(__VA_ARGS__) || ej_handler_stopped(buffer))
+
+/* a string at the offset as a slice, escaped strings are decoded into the scratch */
+static EJBool ej_scan_string_slice(EJBuffer *buffer, const EJString **data, size_t *length) {
+  size_t len, skip;
+  const EJString *sdata;
+
+  if (!ej_scan_string(buffer, &len, &skip)) { return false; }
+
+  sdata = ej_read_inner(buffer, 0);
+  if (skip == 0) {
+    *data = sdata;
+    *length = len;
+  }
+  else {
+    if (buffer->size_scratch < len + 1) {
+      buffer->size_scratch = len + 1;
+      buffer->scratch = ej_realloc(buffer->scratch, buffer->size_scratch);
+    }
+    if (ej_remove_escaped_string(buffer->scratch, sdata, len) == NULL) {
+      ej_set_error(buffer, "Parse string failed");
+      return false;
+    }
+    *data = buffer->scratch;
+    *length = ej_strlen(buffer->scratch);
+  }
+
+  ej_buffer_skip(buffer, len + 1);
+  return true;
+}
+
+/* ej_parse_value */
+static void ej_step_value(EJBuffer *buffer, EJFrame *frame, EJBool *ret, gpointer *result) {
+  EJValue *value = frame->data;
+  EJ_TYPE type;
+  EJBool bvalue;
+  EJNumber number;
+  const EJString *str;
+  size_t len;
+
+  if (frame->state == 1) {
+    if (!*ret) { goto fail; }
+    if (value == NULL) {
+      goto success;
+    }
+    if (value->type == EJ_ARRAY) {
+      value->v.array = *result;
+    }
+    else {
+      value->v.object = *result;
+    }
+    goto success;
+  }
+
+  if (!ej_skip_whitespace(buffer)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+
+  type = ej_lex_value(buffer);
+  if (buffer->handler == NULL) {
+    value = ej_buffer_new0(buffer, EJValue, 1);
+    value->type = type;
+    frame->data = value;
+  }
+
+  switch (type) {
+    case EJ_BOOLEAN:
+      ej_parse_bool(buffer, &bvalue);
+      ej_buffer_skip(buffer, (bvalue ? 4 : 5));
+      if (value != NULL) { value->v.bvalue = bvalue; }
+      if (!EJ_EMIT(buffer, boolean, bvalue, buffer->user_data)) { goto fail; }
+      break;
+    case EJ_NULL:
+      ej_buffer_skip(buffer, 4);
+      if (!EJ_EMIT(buffer, null, buffer->user_data)) { goto fail; }
+      break;
+    case EJ_NUMBER:
+      if (value != NULL) {
+        if (!ej_parse_number_inner(buffer, &value->v.number)) {
+          goto fail;
+        }
+      }
+      else if (!ej_scan_number(buffer, &number) || !EJ_EMIT(buffer, number, &number, buffer->user_data)) {
+        goto fail;
+      }
+      break;
+    case EJ_STRING:
+      if (value != NULL) {
+        if (!ej_parse_string_inner(buffer, &value->v.string, &value->flags, false)) {
+          goto fail;
+        }
+      }
+      else if (!ej_scan_string_slice(buffer, &str, &len) || !EJ_EMIT(buffer, string, str, len, buffer->user_data)) {
+        goto fail;
+      }
+      break;
+    case EJ_ARRAY:
+      frame->state = 1;
+      ej_frame_call(buffer, EJ_FRAME_ARRAY);
+      return;
+    case EJ_OBJECT:
+      frame->state = 1;
+      ej_frame_call(buffer, EJ_FRAME_OBJECT);
+      return;
+    case EJ_EOBJECT:
+      ej_buffer_skip(buffer, 1);
+      ej_skip_whitespace(buffer);
+      if (!EJ_EMIT(buffer, eobject, buffer->user_data)) { goto fail; }
+
+      frame->state = 1;
+      ej_frame_call(buffer, EJ_FRAME_OBJECT);
+      return;
+    default:
+      ej_set_error(buffer, "Value should starts with '[' or '{' or '\"' or boolean");
+      goto fail;
+  }
+
+success:
+  *result = value;
+  ej_frame_return(buffer, ret, true);
+  return;
+fail:
+  ej_set_error(buffer, "Parse value failed");
+  ej_buffer_free_value(buffer, value);
+  ej_frame_return(buffer, ret, false);
+}
+
+/* ej_parse_array_inner */
+static void ej_step_array(EJBuffer *buffer, EJFrame *frame, EJBool *ret, gpointer *result) {
+  if (frame->state == 1) {
+    if (!*ret) { goto fail; }
+    if (buffer->handler == NULL) {
+      ej_buffer_stack_push(buffer, *result);
+    }
+
+    if (ej_ensure_char(buffer, EJ_TOKEN_COMMA)) {
+      ej_buffer_skip(buffer, 1);
+
+      if (ej_ensure_char(buffer, EJ_TOKEN_BKT_END)) {
+        goto success;
+      }
+    }
+    else if (ej_token_is(buffer, EJ_TOKEN_BKT_END)) {
+      goto success;
+    }
+    else {
+      goto fail;
+    }
+    goto next;
+  }
+
+  if (ej_frame_too_deep(buffer)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+
+  ej_buffer_skip(buffer, 1);
+  if (!EJ_EMIT(buffer, begin_array, buffer->user_data)) { goto fail; }
+
+  frame->mark = ej_buffer_stack_mark(buffer);
+  if (ej_ensure_char(buffer, EJ_TOKEN_BKT_END)) { goto success; }
+
+next:
+  frame->state = 1;
+  ej_frame_call(buffer, EJ_FRAME_VALUE);
+  return;
+
+success:
+  if (!ej_token_is(buffer, EJ_TOKEN_BKT_END)) {
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+  if (!EJ_EMIT(buffer, end_array, buffer->user_data)) { goto fail; }
+
+  if (buffer->handler == NULL) {
+    *result = ej_buffer_stack_pop_array(buffer, frame->mark, (GDestroyNotify)ej_free_value);
+  }
+  ej_frame_return(buffer, ret, true);
+  return;
+fail:
+  ej_set_error(buffer, "Parse array failed");
+  ej_buffer_stack_discard(buffer, frame->mark, (GDestroyNotify)ej_free_value);
+  ej_frame_return(buffer, ret, false);
+}
+
+/* ej_parse_object_inner */
+static void ej_step_object(EJBuffer *buffer, EJFrame *frame, EJBool *ret, gpointer *result) {
+  if (frame->state == 1) {
+    if (!*ret) { goto fail; }
+
+    if (!ej_skip_whitespace(buffer)) {
+      ej_buffer_free_object_pair(buffer, *result);
+      goto fail;
+    }
+
+    if (buffer->handler == NULL) {
+      ej_buffer_stack_push(buffer, *result);
+    }
+    if (ej_token_is(buffer, EJ_TOKEN_COMMA)) {
+      ej_buffer_skip(buffer, 1);
+
+      if (!ej_skip_whitespace(buffer)) { goto fail; }
+      if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+        goto success;
+      }
+    }
+    else if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+      goto success;
+    }
+    else {
+      ej_set_error(buffer, "Missing ',' before when parse object");
+      goto fail;
+    }
+    goto next;
+  }
+
+  if (ej_frame_too_deep(buffer)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+
+  ej_buffer_skip(buffer, 1);
+  if (!ej_skip_whitespace(buffer)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+  if (!EJ_EMIT(buffer, begin_object, buffer->user_data)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+
+  frame->mark = ej_buffer_stack_mark(buffer);
+
+  if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+    goto success;
+  }
+
+next:
+  frame->state = 1;
+  ej_frame_call(buffer, EJ_FRAME_PAIR);
+  return;
+
+success:
+  if (!ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+    ej_set_error(buffer, "Not end with } when parse object");
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+  if (!EJ_EMIT(buffer, end_object, buffer->user_data)) { goto fail; }
+
+  if (buffer->handler == NULL) {
+    *result = ej_buffer_stack_pop_array(buffer, frame->mark, (GDestroyNotify)ej_free_object_pair);
+  }
+  ej_frame_return(buffer, ret, true);
+  return;
+fail:
+  ej_buffer_stack_discard(buffer, frame->mark, (GDestroyNotify)ej_free_object_pair);
+  ej_frame_return(buffer, ret, false);
+}
+
+/* ej_parse_object_pair */
+static void ej_step_pair(EJBuffer *buffer, EJFrame *frame, EJBool *ret, gpointer *result) {
+  EJObjectPair *pair = frame->data;
+
+  switch (frame->state) {
+    case 1: {
+      if (!*ret) { goto fail; }
+      if (pair != NULL) { pair->key = *result; }
+
+      if (ej_ensure_char(buffer, EJ_TOKEN_LT)) {
+        frame->state = 2;
+        ej_frame_call(buffer, EJ_FRAME_PROPS);
+        return;
+      }
+      goto colon;
+    }
+    case 2: {
+      if (!*ret) { goto fail; }
+      if (pair != NULL) { pair->props = *result; }
+      goto colon;
+    }
+    case 3: {
+      if (!*ret) { goto fail; }
+      if (pair != NULL) { pair->value = *result; }
+
+      *result = pair;
+      ej_frame_return(buffer, ret, true);
+      return;
+    }
+    default:
+      break;
+  }
+
+  if (!ej_skip_whitespace(buffer)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+
+  if (buffer->handler == NULL) {
+    frame->data = ej_buffer_new0(buffer, EJObjectPair, 1);
+  }
+  frame->state = 1;
+  ej_frame_call(buffer, EJ_FRAME_KEY);
+  return;
+
+colon:
+  if (!ej_ensure_char(buffer, EJ_TOKEN_COLON)) {
+    ej_set_error(buffer, "Missing ':' before parse object value");
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+
+  frame->state = 3;
+  ej_frame_call(buffer, EJ_FRAME_VALUE);
+  return;
+fail:
+  ej_buffer_free_object_pair(buffer, pair);
+  ej_frame_return(buffer, ret, false);
+}
+
+/* ej_parse_object_props */
+static void ej_step_props(EJBuffer *buffer, EJFrame *frame, EJBool *ret, gpointer *result) {
+  EJObjectPair *pair = frame->data;
+
+  switch (frame->state) {
+    case 1: {
+      if (!*ret) {
+        ej_buffer_free_object_pair(buffer, pair);
+        goto fail;
+      }
+      if (pair != NULL) { pair->key = *result; }
+
+      if (!ej_skip_whitespace(buffer)) {
+        ej_buffer_free_object_pair(buffer, pair);
+        goto fail;
+      }
+
+      if (ej_token_is(buffer, EJ_TOKEN_LT)) {
+        frame->state = 2;
+        ej_frame_call(buffer, EJ_FRAME_PROPS);
+        return;
+      }
+      goto colon;
+    }
+    case 2: {
+      if (!*ret) {
+        ej_buffer_free_object_pair(buffer, pair);
+        ej_set_error(buffer, "Parse property failed");
+        goto fail;
+      }
+      if (pair != NULL) { pair->props = *result; }
+      goto colon;
+    }
+    case 3: {
+      if (!*ret) {
+        ej_set_error(buffer, "Parse property value failed");
+        ej_buffer_free_object_pair(buffer, pair);
+        goto fail;
+      }
+      if (pair != NULL) {
+        pair->value = *result;
+        ej_buffer_stack_push(buffer, pair);
+      }
+
+      if (ej_token_is(buffer, EJ_TOKEN_COMMA)) {
+        ej_buffer_skip(buffer, 1);
+        if (ej_ensure_char(buffer, EJ_TOKEN_GT)) {
+          goto success;
+        }
+      } else if (ej_token_is(buffer, EJ_TOKEN_GT)) {
+        goto success;
+      } else {
+        goto fail;
+      }
+      goto next;
+    }
+    default:
+      break;
+  }
+
+  if (ej_frame_too_deep(buffer)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+
+  ej_assert(ej_token_is(buffer, EJ_TOKEN_LT));
+  ej_buffer_skip(buffer, 1);
+  if (!ej_skip_whitespace(buffer)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+  if (!EJ_EMIT(buffer, begin_props, buffer->user_data)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+
+  frame->mark = ej_buffer_stack_mark(buffer);
+  if (ej_ensure_char(buffer, EJ_TOKEN_GT)) {
+    goto success;
+  }
+
+next:
+  if (!ej_valid(buffer, 1)) {
+    goto fail;
+  }
+
+  if (buffer->handler == NULL) {
+    frame->data = ej_buffer_new0(buffer, EJObjectPair, 1);
+  }
+  frame->state = 1;
+  ej_frame_call(buffer, EJ_FRAME_KEY);
+  return;
+
+colon:
+  if (!ej_token_is(buffer, EJ_TOKEN_COLON)) {
+    ej_set_error(buffer, "Missing ':' before parse key property value");
+    ej_buffer_free_object_pair(buffer, pair);
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+
+  frame->state = 3;
+  ej_frame_call(buffer, EJ_FRAME_VALUE);
+  return;
+
+success:
+  if (!ej_token_is(buffer, EJ_TOKEN_GT)) {
+    goto fail;
+  }
+  ej_buffer_skip(buffer, 1);
+  if (!EJ_EMIT(buffer, end_props, buffer->user_data)) { goto fail; }
+
+  if (buffer->handler == NULL) {
+    *result = ej_buffer_stack_pop_array(buffer, frame->mark, (GDestroyNotify)ej_free_object_pair);
+  }
+  ej_frame_return(buffer, ret, true);
+  return;
+fail:
+  ej_buffer_stack_discard(buffer, frame->mark, (GDestroyNotify)ej_free_object_pair);
+  ej_frame_return(buffer, ret, false);
+}
+
+/* ej_parse_key. an '@' key that isn't an object falls back to a plain key,
+ * unless its events have been reported already */
+static void ej_step_key(EJBuffer *buffer, EJFrame *frame, EJBool *ret, gpointer *result) {
+  EJValue *kv = frame->data;
+  const EJString *str;
+  size_t len;
+
+  if (frame->state == 1) {
+    if (*ret) {
+      if (kv != NULL) { kv->v.object = *result; }
+      goto success;
+    }
+    if (kv == NULL) { goto fail; }
+    goto string;
+  }
+
+  if (!ej_skip_whitespace(buffer) || ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+    ej_frame_return(buffer, ret, false);
+    return;
+  }
+
+  if (buffer->handler == NULL) {
+    kv = ej_buffer_new0(buffer, EJValue, 1);
+    frame->data = kv;
+  }
+  if (ej_read_c_inner(buffer, 0) == '@') {
+    ej_buffer_skip(buffer, 1);
+
+    if (kv != NULL) { kv->type = EJ_EOBJECT; }
+    if (ej_token_is(buffer, EJ_TOKEN_CUR_START)) {
+      if (!EJ_EMIT(buffer, eobject, buffer->user_data)) { goto fail; }
+
+      frame->state = 1;
+      ej_frame_call(buffer, EJ_FRAME_OBJECT);
+      return;
+    }
+  }
+
+string:
+  if (kv == NULL) {
+    if (ej_token_is(buffer, EJ_TOKEN_QMARK) && ej_scan_string_slice(buffer, &str, &len)) {
+      if (!EJ_EMIT(buffer, key, str, len, buffer->user_data)) { goto fail; }
+      goto success;
+    }
+
+    len = ej_scan_key_without_quote(buffer);
+    if (len == 0) {
+      goto fail;
+    }
+    str = ej_read_inner(buffer, 0);
+    ej_buffer_skip(buffer, len);
+  }
+  else {
+    if (ej_token_is(buffer, EJ_TOKEN_QMARK) && ej_parse_string_inner(buffer, &kv->v.string, &kv->flags, true)) {
+      kv->type = EJ_STRING;
+      goto success;
+    }
+
+    kv->type = EJ_STRING;
+    if (!ej_take_key_without_quote(buffer, ej_scan_key_without_quote(buffer), &kv->v.string, &kv->flags)) {
+      goto fail;
+    }
+  }
+
+  if (!ej_valid(buffer, 1)) {
+    ej_set_error(buffer, "Occour buffer end when parse key.");
+    goto fail;
+  }
+  if (!EJ_EMIT(buffer, key, str, len, buffer->user_data)) { goto fail; }
+
+success:
+  *result = kv;
+  ej_frame_return(buffer, ret, true);
+  return;
+fail:
+  ej_buffer_free_value(buffer, kv);
+  ej_frame_return(buffer, ret, false);
+}
+
+/* run the top frame once */
+static void ej_step(EJBuffer *buffer, EJBool *ret, gpointer *result) {
+  EJFrame *frame = &buffer->frames[buffer->n_frames - 1];
+
+  switch (frame->type) {
+    case EJ_FRAME_VALUE:
+      ej_step_value(buffer, frame, ret, result);
+      break;
+    case EJ_FRAME_ARRAY:
+      ej_step_array(buffer, frame, ret, result);
+      break;
+    case EJ_FRAME_OBJECT:
+      ej_step_object(buffer, frame, ret, result);
+      break;
+    case EJ_FRAME_PAIR:
+      ej_step_pair(buffer, frame, ret, result);
+      break;
+    case EJ_FRAME_PROPS:
+      ej_step_props(buffer, frame, ret, result);
+      break;
+    case EJ_FRAME_KEY:
+      ej_step_key(buffer, frame, ret, result);
+      break;
+  }
+}
+
+static EJBool ej_parse_value_iterative(EJBuffer *buffer, EJValue **data) {
+  size_t base = buffer->n_frames;
+  EJBool ret = false;
+  gpointer result = NULL;
+
+  ej_frame_call(buffer, EJ_FRAME_VALUE);
+
+  while (buffer->n_frames > base) {
+    ej_step(buffer, &ret, &result);
+  }
+
+  if (ret) {
+    *data = result;
+  }
+  return ret;
+}
+
+/* indexed mode, stage 1 classifies the content 64 bytes at a time into one bit
+ * per byte and keeps the offsets of the tokens it finds, stage 2 builds the tree
+ * by walking those offsets with the leaf parsers above. */
+static inline guint64 ej_prefix_xor(guint64 v) {
+  v ^= v << 1;
+  v ^= v << 2;
+  v ^= v << 4;
+  v ^= v << 8;
+  v ^= v << 16;
+  v ^= v << 32;
+
+  return v;
+}
+
+/* bytes behind a backslash which is not escaped itself, the carry crosses blocks */
+static guint64 ej_index_escaped(guint64 backslash, EJBool *carry) {
+  guint64 escaped = *carry ? 1 : 0, bit;
+  unsigned int i;
+
+  *carry = false;
+  backslash &= ~escaped;
+  while (backslash != 0) {
+    i = ej_ctz64(backslash);
+    if (i == 63) {
+      *carry = true;
+      break;
+    }
+
+    bit = (guint64)1 << i;
+    escaped |= bit << 1;
+    backslash &= ~(bit | (bit << 1));
+  }
+
+  return escaped;
+}
+
+static void ej_index_push(EJIndex *index, size_t pos) {
+  if (index->n_starts == index->size_starts) {
+    index->size_starts = index->size_starts > 0 ? index->size_starts * 2 : 256;
+    index->starts = ej_realloc(index->starts, sizeof(size_t) * index->size_starts);
+  }
+
+  index->starts[index->n_starts++] = pos;
+}
+
+/* the lexer of the push parser over [pos, end), for blocks with comments or a
+ * terminator, which ends the index as it ends the document for ej_parse */
+static void ej_index_scan(EJIndex *index, size_t pos, size_t end) {
+  const EJString *content = index->buffer->content;
+  EJString c;
+
+  for (; pos < end && !index->done; pos++) {
+    c = content[pos];
+
+    switch (index->state) {
+      case EJ_LEX_GAP:
+        if (ej_is_whitespace(c)) { break; }
+
+        if (c == '/') {
+          index->state = EJ_LEX_SLASH;
+          break;
+        }
+        ej_index_push(index, pos);
+        if (c == '\0') {
+          index->done = true;
+        }
+        else if (c == '"') {
+          index->state = EJ_LEX_STRING;
+        }
+        else if (ej_is_word_char(c)) {
+          index->state = EJ_LEX_WORD;
+        }
+        break;
+      case EJ_LEX_WORD:
+        if (!ej_is_word_char(c)) {
+          index->state = EJ_LEX_GAP;
+          pos--;
+        }
+        break;
+      case EJ_LEX_STRING:
+      case EJ_LEX_ESCAPE:
+        if (c == '\0') {
+          ej_index_push(index, pos);
+          index->done = true;
+        }
+        else if (index->state == EJ_LEX_ESCAPE) {
+          index->state = EJ_LEX_STRING;
+        }
+        else if (c == '\\') {
+          index->state = EJ_LEX_ESCAPE;
+        }
+        else if (c == '"') {
+          /* the closing quote is kept too, it gives the length of the string */
+          ej_index_push(index, pos);
+          index->state = EJ_LEX_GAP;
+        }
+        break;
+      case EJ_LEX_SLASH:
+        if (c == '/') {
+          index->state = EJ_LEX_LINE_FIRST;
+        }
+        else if (c == '*') {
+          index->state = EJ_LEX_BLOCK_FIRST;
+        }
+        else {
+          ej_index_push(index, pos - 1);
+          index->state = EJ_LEX_GAP;
+          pos--;
+        }
+        break;
+      case EJ_LEX_LINE_FIRST:
+        index->state = EJ_LEX_LINE;
+        break;
+      case EJ_LEX_LINE:
+        if (c == '\n') { index->state = EJ_LEX_GAP; }
+        break;
+      case EJ_LEX_BLOCK_FIRST:
+        index->state = EJ_LEX_BLOCK;
+        break;
+      case EJ_LEX_BLOCK:
+        if (c == '*') { index->state = EJ_LEX_BLOCK_STAR; }
+        break;
+      case EJ_LEX_BLOCK_STAR:
+        index->state = c == '/' ? EJ_LEX_GAP : EJ_LEX_BLOCK;
+        break;
+    }
+  }
+}
+
+#if EJ_SIMD_AVX2 || EJ_SIMD_SSE2
+typedef struct _EJIndexBlock EJIndexBlock;
+
+struct _EJIndexBlock {
+  guint64 ws;
+  guint64 quote;
+  guint64 backslash;
+  guint64 slash;
+  guint64 star;
+  guint64 word;
+  guint64 nul;
+};
+
+#if EJ_SIMD_AVX2
+#define EJ_INDEX_LANES 32
+#define ej_index_vector __m256i
+#define ej_index_load(p) _mm256_loadu_si256((const __m256i *)(p))
+#define ej_index_set1(c) _mm256_set1_epi8(c)
+#define ej_index_eq(a, b) _mm256_cmpeq_epi8(a, b)
+#define ej_index_gt(a, b) _mm256_cmpgt_epi8(a, b)
+#define ej_index_or(a, b) _mm256_or_si256(a, b)
+#define ej_index_and(a, b) _mm256_and_si256(a, b)
+#define ej_index_mask(v) ((guint64)(guint32)_mm256_movemask_epi8(v))
+#else
+#define EJ_INDEX_LANES 16
+#define ej_index_vector __m128i
+#define ej_index_load(p) _mm_loadu_si128((const __m128i *)(p))
+#define ej_index_set1(c) _mm_set1_epi8(c)
+#define ej_index_eq(a, b) _mm_cmpeq_epi8(a, b)
+#define ej_index_gt(a, b) _mm_cmpgt_epi8(a, b)
+#define ej_index_or(a, b) _mm_or_si128(a, b)
+#define ej_index_and(a, b) _mm_and_si128(a, b)
+#define ej_index_mask(v) ((guint64)(guint32)_mm_movemask_epi8(v))
+#endif
+
+/* one bit per byte of the 64 bytes at p for every class the lexer tells apart */
+static void ej_index_classify(const EJString *p, EJIndexBlock *block) {
+  const ej_index_vector sp = ej_index_set1(' '), cr = ej_index_set1('\r'), nl = ej_index_set1('\n');
+  const ej_index_vector quote = ej_index_set1('"'), backslash = ej_index_set1('\\');
+  const ej_index_vector slash = ej_index_set1('/'), star = ej_index_set1('*'), nul = ej_index_set1('\0');
+  const ej_index_vector minus = ej_index_set1('-'), under = ej_index_set1('_');
+  const ej_index_vector dot = ej_index_set1('.'), plus = ej_index_set1('+');
+  const ej_index_vector digit_lo = ej_index_set1('0' - 1), digit_hi = ej_index_set1('9' + 1);
+  const ej_index_vector alpha_lo = ej_index_set1('a' - 1), alpha_hi = ej_index_set1('z' + 1);
+  const ej_index_vector lower = ej_index_set1(0x20);
+  ej_index_vector v, l, word;
+  int i;
+
+  memset(block, 0, sizeof(EJIndexBlock));
+  for (i = 0; i < 64; i += EJ_INDEX_LANES) {
+    v = ej_index_load(p + i);
+    /* bytes above 0x7f compare as negative and are no word chars */
+    l = ej_index_or(v, lower);
+    word = ej_index_or(ej_index_and(ej_index_gt(v, digit_lo), ej_index_gt(digit_hi, v)),
+      ej_index_and(ej_index_gt(l, alpha_lo), ej_index_gt(alpha_hi, l)));
+    word = ej_index_or(ej_index_or(word, ej_index_eq(v, minus)), ej_index_or(ej_index_eq(v, under),
+      ej_index_or(ej_index_eq(v, dot), ej_index_eq(v, plus))));
+
+    block->ws |= ej_index_mask(ej_index_or(ej_index_or(ej_index_eq(v, sp), ej_index_eq(v, cr)), ej_index_eq(v, nl))) << i;
+    block->quote |= ej_index_mask(ej_index_eq(v, quote)) << i;
+    block->backslash |= ej_index_mask(ej_index_eq(v, backslash)) << i;
+    block->slash |= ej_index_mask(ej_index_eq(v, slash)) << i;
+    block->star |= ej_index_mask(ej_index_eq(v, star)) << i;
+    block->word |= ej_index_mask(word) << i;
+    block->nul |= ej_index_mask(ej_index_eq(v, nul)) << i;
+  }
+}
+
+/* the 64 bytes at pos from the state before them, false when they need the lexer */
+static EJBool ej_index_block(EJIndex *index, size_t pos) {
+  const EJString *content = index->buffer->content;
+  EJIndexBlock block;
+  guint64 escaped, quotes, string, outside, comment, starts, next;
+  EJBool carry = index->state == EJ_LEX_ESCAPE;
+  EJString ahead;
+
+  /* comments are left to the lexer */
+  if (index->state != EJ_LEX_GAP && index->state != EJ_LEX_WORD && index->state != EJ_LEX_STRING && !carry) {
+    return false;
+  }
+
+  ej_index_classify(content + pos, &block);
+  if (block.nul != 0) { return false; }
+
+  escaped = ej_index_escaped(block.backslash, &carry);
+  quotes = block.quote & ~escaped;
+  /* from the opening quote up to the closing one */
+  string = ej_prefix_xor(quotes);
+  if (index->state == EJ_LEX_STRING || index->state == EJ_LEX_ESCAPE) { string = ~string; }
+  outside = ~string & ~quotes;
+
+  /* a slash followed by a slash or star starts a comment */
+  ahead = pos + 64 < index->buffer->length ? content[pos + 64] : '\0';
+  next = (block.slash | block.star) >> 1;
+  if (ahead == '/' || ahead == '*') { next |= (guint64)1 << 63; }
+  comment = block.slash & outside & next;
+  if (comment != 0) { return false; }
+
+  starts = quotes | (outside & ~block.ws & ~(block.word & ((block.word << 1) | (index->state == EJ_LEX_WORD ? 1 : 0))));
+  while (starts != 0) {
+    ej_index_push(index, pos + ej_ctz64(starts));
+    starts &= starts - 1;
+  }
+
+  if (string >> 63) {
+    index->state = carry ? EJ_LEX_ESCAPE : EJ_LEX_STRING;
+  }
+  else {
+    index->state = (block.word & outside) >> 63 ? EJ_LEX_WORD : EJ_LEX_GAP;
+  }
+  return true;
+}
+#endif
+
+/* index on until at least one more token start is known or the content ends */
+static void ej_index_fill(EJIndex *index) {
+  size_t len = index->buffer->length, stop = index->pos + EJ_INDEX_CHUNK;
+
+  /* stage 2 never looks back, the consumed offsets are dropped */
+  if (index->next > 0) {
+    index->n_starts -= index->next;
+    memmove(index->starts, index->starts + index->next, sizeof(size_t) * index->n_starts);
+    index->next = 0;
+  }
+
+  while (!index->done && (index->pos < stop || index->n_starts == 0)) {
+    if (index->pos + 64 > len) {
+      ej_index_scan(index, index->pos, len);
+      if (!index->done && index->state == EJ_LEX_SLASH) { ej_index_push(index, len - 1); }
+      index->pos = len;
+      index->done = true;
+      break;
+    }
+
+#if EJ_SIMD_AVX2 || EJ_SIMD_SSE2
+    if (!ej_index_block(index, index->pos)) {
+      ej_index_scan(index, index->pos, index->pos + 64);
+    }
+#else
+    ej_index_scan(index, index->pos, index->pos + 64);
+#endif
+    index->pos += 64;
+  }
+}
+
+/* offset of the next token, false behind the last one */
+static EJBool ej_index_peek(EJIndex *index, size_t *pos) {
+  while (index->next == index->n_starts) {
+    if (index->done) { return false; }
+    ej_index_fill(index);
+  }
+
+  *pos = index->starts[index->next];
+  return true;
+}
+
+/* take the next token when it is c, right at the offset when tight */
+static EJBool ej_index_take(EJIndex *index, EJString c, EJBool tight) {
+  EJBuffer *buffer = index->buffer;
+  size_t pos;
+
+  if (!ej_index_peek(index, &pos) || buffer->content[pos] != c || (tight && pos != buffer->offset)) {
+    return false;
+  }
+
+  index->next++;
+  buffer->offset = pos + 1;
+  return true;
+}
+
+static size_t ej_index_word_end(EJBuffer *buffer, size_t pos) {
+  while (pos < buffer->length && ej_is_word_char(buffer->content[pos])) {
+    pos++;
+  }
+
+  return pos;
+}
+
+/* the string whose opening quote is the next token */
+static EJBool ej_index_string(EJIndex *index, EJString **data, EJ_VALUE_FLAGS *flags, EJBool key) {
+  EJBuffer *buffer = index->buffer;
+  size_t start = index->starts[index->next++], end, len;
+
+  if (!ej_index_peek(index, &end) || buffer->content[end] != '"') { return false; }
+  index->next++;
+
+  len = end - start - 1;
+  if (len + 1 > EJ_STR_MAX) { return false; }
+  if (!ej_decode_string(buffer, buffer->content + start + 1, len, memchr(buffer->content + start + 1, '\\', len) != NULL,
+    data, flags, key)) {
+    return false;
+  }
+
+  buffer->offset = end + 1;
+  return true;
+}
+
+static EJBool ej_index_value(EJIndex *index, EJValue **data);
+static EJBool ej_index_members(EJIndex *index, EJString close, EJArray **data);
+
+static EJBool ej_index_key(EJIndex *index, EJValue **data) {
+  EJBuffer *buffer = index->buffer;
+  EJValue *kv;
+  size_t pos, end, i;
+  EJString c;
+
+  if (!ej_index_peek(index, &pos)) { return false; }
+  buffer->offset = pos;
+
+  kv = ej_buffer_new0(buffer, EJValue, 1);
+  switch (buffer->content[pos]) {
+    case '@':
+      /* ej_parse_key wants the '{' right behind the '@' */
+      index->next++;
+      buffer->offset = pos + 1;
+      kv->type = EJ_EOBJECT;
+      if (!ej_index_take(index, '{', true) || !ej_index_members(index, '}', &kv->v.object)) { goto fail; }
+      break;
+    case '"':
+      kv->type = EJ_STRING;
+      if (!ej_index_string(index, &kv->v.string, &kv->flags, true)) { goto fail; }
+      break;
+    default:
+      /* the word is the key as in ej_parse_key_without_quote, 'a.b' is none */
+      index->next++;
+      kv->type = EJ_STRING;
+      end = ej_index_word_end(buffer, pos);
+      if (end == pos || end - pos > EJ_STR_MAX) { goto fail; }
+      for (i = pos; i < end; i++) {
+        c = buffer->content[i];
+        if (!ej_ascii_isalnum(c) && c != '-' && c != '_') { goto fail; }
+      }
+
+      if (buffer->keys != NULL) {
+        kv->v.string = (EJString *)ej_key_table_intern_len(buffer->keys, buffer->content + pos, end - pos);
+        kv->flags |= EJ_VALUE_FLAG_BORROWED | EJ_VALUE_FLAG_INTERNED;
+      }
+      else {
+        kv->v.string = ej_buffer_strndup(buffer, buffer->content + pos, end - pos);
+      }
+      buffer->offset = end;
+      break;
+  }
+
+  *data = kv;
+  return true;
+fail:
+  ej_buffer_free_value(buffer, kv);
+  return false;
+}
+
+/* object members up to '}' or props up to '>', the opening one is taken. as in
+ * ej_parse_object_props the ',' or '>' of props follows the value directly */
+static EJBool ej_index_members(EJIndex *index, EJString close, EJArray **data) {
+  EJBuffer *buffer = index->buffer;
+  EJBool props = close == '>', tight;
+  EJObjectPair *pair;
+  size_t mark;
+
+  mark = ej_buffer_stack_mark(buffer);
+  if (ej_index_take(index, close, false)) { goto success; }
+
+  while (true) {
+    pair = ej_buffer_new0(buffer, EJObjectPair, 1);
+    if (!ej_index_key(index, &pair->key)) { goto fail_pair; }
+
+    tight = false;
+    if (ej_index_take(index, '<', false)) {
+      if (!ej_index_members(index, '>', &pair->props)) { goto fail_pair; }
+      tight = props;
+    }
+
+    if (!ej_index_take(index, ':', tight) || !ej_index_value(index, &pair->value)) { goto fail_pair; }
+    ej_buffer_stack_push(buffer, pair);
+
+    if (ej_index_take(index, ',', props)) {
+      if (ej_index_take(index, close, false)) { break; }
+    }
+    else if (ej_index_take(index, close, props)) {
+      break;
+    }
+    else {
+      goto fail;
+    }
+  }
+
+success:
+  *data = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  return true;
+fail_pair:
+  ej_buffer_free_object_pair(buffer, pair);
+fail:
+  ej_buffer_stack_discard(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  return false;
+}
+
+static EJBool ej_index_array(EJIndex *index, EJArray **data) {
+  EJBuffer *buffer = index->buffer;
+  EJValue *value;
+  size_t mark;
+
+  mark = ej_buffer_stack_mark(buffer);
+  if (ej_index_take(index, ']', false)) { goto success; }
+
+  while (true) {
+    if (!ej_index_value(index, &value)) { goto fail; }
+    ej_buffer_stack_push(buffer, value);
+
+    if (ej_index_take(index, ',', false)) {
+      if (ej_index_take(index, ']', false)) { break; }
+    }
+    else if (ej_index_take(index, ']', false)) {
+      break;
+    }
+    else {
+      goto fail;
+    }
+  }
+
+success:
+  *data = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_value);
+  return true;
+fail:
+  ej_buffer_stack_discard(buffer, mark, (GDestroyNotify)ej_free_value);
+  return false;
+}
+
+/* false for anything ej_parse_value would not take the same way, nothing is reported */
+static EJBool ej_index_value(EJIndex *index, EJValue **data) {
+  EJBuffer *buffer = index->buffer;
+  EJValue *value;
+  size_t pos;
+  EJString c;
+
+  if (!ej_index_peek(index, &pos)) { return false; }
+  buffer->offset = pos;
+
+  value = ej_buffer_new0(buffer, EJValue, 1);
+  value->type = EJ_RAW;
+
+  c = buffer->content[pos];
+  switch (c) {
+    case '"':
+      value->type = EJ_STRING;
+      if (!ej_index_string(index, &value->v.string, &value->flags, false)) { goto fail; }
+      break;
+    case '[':
+      index->next++;
+      value->type = EJ_ARRAY;
+      if (!ej_index_array(index, &value->v.array)) { goto fail; }
+      break;
+    case '{':
+      index->next++;
+      value->type = EJ_OBJECT;
+      if (!ej_index_members(index, '}', &value->v.object)) { goto fail; }
+      break;
+    case '@':
+      index->next++;
+      value->type = EJ_EOBJECT;
+      if (!ej_index_take(index, '{', false) || !ej_index_members(index, '}', &value->v.object)) { goto fail; }
+      break;
+    default:
+      index->next++;
+      value->type = ej_lex_value(buffer);
+      if (value->type == EJ_BOOLEAN) {
+        ej_parse_bool(buffer, &value->v.bvalue);
+        ej_buffer_skip(buffer, (value->v.bvalue ? 4 : 5));
+      }
+      else if (value->type == EJ_NULL) {
+        ej_buffer_skip(buffer, 4);
+      }
+      else if (value->type == EJ_NUMBER) {
+        if (!ej_parse_number_inner(buffer, &value->v.number)) { goto fail; }
+      }
+      else {
+        value->type = EJ_INVALID;
+        goto fail;
+      }
+
+      /* 'truex' or '12ab' go on as another token in ej_parse_value */
+      if (buffer->offset != ej_index_word_end(buffer, pos)) { goto fail; }
+      break;
+  }
+
+  *data = value;
+  return true;
+fail:
+  ej_buffer_free_value(buffer, value);
+  return false;
+}
+
+/* documents the index walk does not take, and in situ buffers whose strings it
+ * may already have decoded, are parsed by ej_parse_value from the start */
+static EJBool ej_parse_value_indexed(EJBuffer *buffer, EJValue **data) {
+  EJIndex index = { 0 };
+  size_t start = buffer->offset;
+  EJBool ret, clean = buffer->error->message == NULL;
+
+  if (!buffer->insitu) {
+    index.buffer = buffer;
+    index.pos = start;
+    index.state = EJ_LEX_GAP;
+
+    ret = ej_index_value(&index, data);
+    ej_free(index.starts);
+    if (ret) { return true; }
+
+    if (clean && buffer->error->message != NULL) {
+      ej_free(buffer->error->message);
+      buffer->error->message = NULL;
+    }
+    buffer->offset = start;
+  }
+
+  buffer->mode = EJ_MODE_RECURSIVE;
+  ret = ej_parse_value(buffer, data);
+  buffer->mode = EJ_MODE_INDEXED;
+
+  return ret;
+}
+
+static EJBool ej_parse_events_value(EJBuffer *buffer) {
+  EJValue *value = NULL;
+
+  return ej_parse_value_iterative(buffer, &value);
+}
+
+EJ_MODULE_EXPORT(EJBuffer*) ej_buffer_mode_new(const EJString *content, size_t len, EJ_MODE_TYPE mode) {
+  ej_return_val_if_fail(content != NULL, NULL);
+
+  EJBuffer *buffer = ej_new0(EJBuffer, 1);
+
+  buffer->content = content;
+  buffer->length = len;
+  buffer->offset = 0;
+  buffer->error = ej_error_new();
+  buffer->mode = mode;
+  buffer->arena = NULL;
+  buffer->insitu = false;
+  buffer->lines = NULL;
+  buffer->n_lines = 0;
+  buffer->origin_row = 0;
+  buffer->origin_col = 0;
+  buffer->stack = ej_ptr_array_new();
+  buffer->frames = NULL;
+  buffer->n_frames = 0;
+  buffer->size_frames = 0;
+  buffer->depth = 0;
+  buffer->max_depth = 0;
+  buffer->n_threads = 0;
+  buffer->options = EJ_PARSE_EXTENDED;
+  buffer->validate_utf8 = false;
+  buffer->handler = NULL;
+  buffer->user_data = NULL;
+  buffer->scratch = NULL;
+  buffer->size_scratch = 0;
+
+  return buffer;
+}
+
+EJ_MODULE_EXPORT(EJBuffer*) ej_buffer_insitu_new(EJString *content, size_t len) {
+  EJBuffer *buffer = ej_buffer_new(content, len);
+
+  if (buffer != NULL) {
+    buffer->insitu = true;
+    /* now, decoding writes the '\n' of escapes into the content */
+    ej_buffer_build_lines(buffer);
+  }
+
+  return buffer;
+}
+
+EJ_MODULE_EXPORT(void) ej_buffer_set_arena(EJBuffer *buffer, EJArena *arena) {
+  ej_return_if_fail(buffer != NULL);
+
+  buffer->arena = arena;
+}
+
+EJ_MODULE_EXPORT(void) ej_buffer_set_max_depth(EJBuffer *buffer, size_t max_depth) {
+  ej_return_if_fail(buffer != NULL);
+
+  buffer->max_depth = max_depth;
+}
+
+EJ_MODULE_EXPORT(void) ej_buffer_set_threads(EJBuffer *buffer, guint n_threads) {
+  ej_return_if_fail(buffer != NULL);
+
+  buffer->n_threads = n_threads;
+}
+
+EJ_MODULE_EXPORT(void) ej_buffer_set_options(EJBuffer *buffer, EJParseOptions options) {
+  ej_return_if_fail(buffer != NULL);
+  ej_return_if_fail(buffer->mode == EJ_MODE_RECURSIVE || buffer->mode == EJ_MODE_PARALLEL);
+
+  buffer->options = options & EJ_PARSE_EXTENDED;
+}
+
+EJ_MODULE_EXPORT(void) ej_buffer_set_validate_utf8(EJBuffer *buffer, EJBool validate) {
+  ej_return_if_fail(buffer != NULL);
+
+  buffer->validate_utf8 = validate;
+}
+
+EJ_MODULE_EXPORT(void) ej_buffer_set_key_table(EJBuffer *buffer, EJKeyTable *keys) {
+  ej_return_if_fail(buffer != NULL);
+
+  buffer->keys = keys;
+}
+
+EJ_MODULE_EXPORT(EJBuffer *) ej_buffer_new(const EJString *content, size_t len) {
+  return ej_buffer_mode_new(content, len, EJ_MODE_RECURSIVE);
+}
+
+/* free the buffer after a whole document was parsed, the error is handed to the caller */
+static EJBool ej_finish_buffer(EJBuffer *buffer, EJBool ret, EJError **error) {
+  if (!ret) {
+    ej_set_error(buffer, "Parse value failed");
+    *error = ej_get_error(buffer);
+  }
+  else if (buffer->error->message != NULL) {
+    /* a failed attempt that was recovered from, eg. an '@' key that isn't an object */
+    ej_free(buffer->error->message);
+    buffer->error->message = NULL;
+  }
+
+  ej_free_buffer(buffer);
+  return ret;
+}
+
+static EJValue *ej_parse_buffer(EJBuffer *buffer, EJError **error) {
+  EJValue *value = NULL;
+
+  ej_skip_utf8_bom(buffer);
+
+  if (!ej_finish_buffer(buffer, ej_parse_value(buffer, &value), error)) {
+    return NULL;
+  }
+  return value;
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse(EJError **error, const EJString *content) {
+  return ej_parse_len(error, content, ej_strlen((const EJString *)content));
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_len(EJError **error, const EJString *content, size_t len) {
+  EJBuffer *buffer;
+
+  buffer = ej_buffer_new(content, len);
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_arena(EJArena *arena, EJError **error, const EJString *content) {
+  EJBuffer *buffer;
+
+  ej_return_val_if_fail(arena != NULL, NULL);
+
+  buffer = ej_buffer_new(content, ej_strlen((const EJString *)content));
+  ej_buffer_set_arena(buffer, arena);
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_parse_events(const EJHandler *handler, gpointer user_data, EJError **error, const EJString *content) {
+  EJBuffer *buffer;
+
+  ej_return_val_if_fail(handler != NULL, false);
+
+  buffer = ej_buffer_new(content, ej_strlen((const EJString *)content));
+  buffer->handler = handler;
+  buffer->user_data = user_data;
+
+  ej_skip_utf8_bom(buffer);
+
+  return ej_finish_buffer(buffer, ej_parse_events_value(buffer), error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_iterative(size_t max_depth, EJError **error, const EJString *content) {
+  EJBuffer *buffer;
+
+  buffer = ej_buffer_mode_new(content, ej_strlen((const EJString *)content), EJ_MODE_ITERATIVE);
+  ej_buffer_set_max_depth(buffer, max_depth);
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_indexed(EJError **error, const EJString *content) {
+  EJBuffer *buffer;
+
+  buffer = ej_buffer_mode_new(content, ej_strlen((const EJString *)content), EJ_MODE_INDEXED);
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_parallel(guint n_threads, EJError **error, const EJString *content) {
+  EJBuffer *buffer;
+
+  buffer = ej_buffer_mode_new(content, ej_strlen((const EJString *)content), EJ_MODE_PARALLEL);
+  ej_buffer_set_threads(buffer, n_threads);
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_options(EJParseOptions options, EJError **error, const EJString *content) {
+  EJBuffer *buffer;
+
+  buffer = ej_buffer_new(content, ej_strlen((const EJString *)content));
+  ej_buffer_set_options(buffer, options);
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_keys(EJKeyTable *keys, EJError **error, const EJString *content) {
+  EJBuffer *buffer;
+
+  ej_return_val_if_fail(keys != NULL, NULL);
+
+  buffer = ej_buffer_new(content, ej_strlen((const EJString *)content));
+  ej_buffer_set_key_table(buffer, keys);
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_insitu(EJError **error, EJString *content) {
+  EJBuffer *buffer;
+
+  buffer = ej_buffer_insitu_new(content, ej_strlen((const EJString *)content));
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_bytes(EJArena *arena, EJError **error, GBytes *bytes) {
+  EJBuffer *buffer;
+  EJString *content;
+  gsize len;
+
+  ej_return_val_if_fail(arena != NULL && bytes != NULL, NULL);
+
+  /* steals the data when this is the last reference, copies it otherwise.
+   * empty bytes give no data */
+  content = g_bytes_unref_to_data(bytes, &len);
+  if (len > 0) {
+    ej_arena_take(arena, content, g_free);
+  }
+  else {
+    g_free(content);
+    content = "";
+  }
+
+  buffer = ej_buffer_insitu_new(content, len);
+  ej_buffer_set_arena(buffer, arena);
+
+  return ej_parse_buffer(buffer, error);
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_parse_file(EJArena *arena, EJError **error, const gchar *path) {
+  GMappedFile *file;
+  GError *gerror = NULL;
+  EJBuffer *buffer;
+  EJString *content;
+  size_t len;
+  EJValue *value;
+  int fd, saved;
+
+  ej_return_val_if_fail(path != NULL, NULL);
+
+  /* g_mapped_file_new opens the file for writing when the mapping is writable */
+  fd = g_open(path, O_RDONLY, 0);
+  if (fd < 0) {
+    saved = errno;
+    *error = ej_error_new();
+    (*error)->message = ej_strdup_printf("Failed to open file \"%s\": %s", path, g_strerror(saved));
+    return NULL;
+  }
+
+  /* a private writable mapping, in situ strings only copy the pages they touch */
+  file = g_mapped_file_new_from_fd(fd, arena != NULL, &gerror);
+  g_close(fd, NULL);
+  if (file == NULL) {
+    *error = ej_error_new();
+    (*error)->message = ej_strdup(gerror->message);
+    g_error_free(gerror);
+    return NULL;
+  }
+
+  /* an empty file has no mapping */
+  len = g_mapped_file_get_length(file);
+  content = len > 0 ? g_mapped_file_get_contents(file) : "";
+
+  if (arena != NULL) {
+    ej_arena_take(arena, file, (GDestroyNotify)g_mapped_file_unref);
+
+    buffer = ej_buffer_insitu_new(content, len);
+    ej_buffer_set_arena(buffer, arena);
+
+    return ej_parse_buffer(buffer, error);
+  }
+
+  value = ej_parse_buffer(ej_buffer_new(content, len), error);
+  g_mapped_file_unref(file);
+
+  return value;
+}
+
+/* push parser, every step of the iterative frames reads at most a few tokens
+ * ahead, so it runs once that many complete tokens are buffered and then sees
+ * the same bytes as on the whole document. */
+static void ej_push_token(EJPushParser *parser, size_t start, size_t end) {
+  parser->starts[parser->n_tokens] = start;
+  parser->ends[parser->n_tokens] = end;
+  parser->n_tokens++;
+  parser->lex_state = EJ_LEX_GAP;
+}
+
+/* lex on from lex_pos until the lookahead is full or the data runs out, words
+ * cover numbers, literals and bare keys, comments follow ej_skip_comment */
+static void ej_push_lex(EJPushParser *parser) {
+  const EJString *content = parser->buffer->content;
+  size_t pos, len = parser->buffer->length;
+  EJString c;
+
+  for (pos = parser->lex_pos; pos < len && parser->n_tokens < EJ_PUSH_LOOKAHEAD; pos++) {
+    c = content[pos];
+
+    switch (parser->lex_state) {
+      case EJ_LEX_GAP:
+        parser->lex_start = pos;
+        if (ej_is_whitespace(c)) { break; }
+
+        if (c == '/') {
+          parser->lex_state = EJ_LEX_SLASH;
+        }
+        else if (c == '"') {
+          parser->lex_state = EJ_LEX_STRING;
+        }
+        else if (ej_is_word_char(c)) {
+          parser->lex_state = EJ_LEX_WORD;
+        }
+        else {
+          ej_push_token(parser, pos, pos + 1);
+        }
+        break;
+      case EJ_LEX_WORD:
+        if (!ej_is_word_char(c)) {
+          /* the terminator starts the next token */
+          ej_push_token(parser, parser->lex_start, pos--);
+        }
+        break;
+      case EJ_LEX_STRING:
+        if (c == '\\') {
+          parser->lex_state = EJ_LEX_ESCAPE;
+        }
+        else if (c == '"') {
+          ej_push_token(parser, parser->lex_start, pos + 1);
+        }
+        break;
+      case EJ_LEX_ESCAPE:
+        parser->lex_state = EJ_LEX_STRING;
+        break;
+      case EJ_LEX_SLASH:
+        if (c == '/') {
+          parser->lex_state = EJ_LEX_LINE_FIRST;
+        }
+        else if (c == '*') {
+          parser->lex_state = EJ_LEX_BLOCK_FIRST;
+        }
+        else {
+          ej_push_token(parser, parser->lex_start, pos--);
+        }
+        break;
+      case EJ_LEX_LINE_FIRST:
+        parser->lex_state = EJ_LEX_LINE;
+        break;
+      case EJ_LEX_LINE:
+        if (c == '\n') { parser->lex_state = EJ_LEX_GAP; }
+        break;
+      case EJ_LEX_BLOCK_FIRST:
+        parser->lex_state = EJ_LEX_BLOCK;
+        break;
+      case EJ_LEX_BLOCK:
+        if (c == '*') { parser->lex_state = EJ_LEX_BLOCK_STAR; }
+        break;
+      case EJ_LEX_BLOCK_STAR:
+        parser->lex_state = c == '/' ? EJ_LEX_GAP : EJ_LEX_BLOCK;
+        break;
+    }
+  }
+
+  parser->lex_pos = pos;
+}
+
+/* forget the tokens behind the offset, lex again from the offset when a
+ * failed '@' key left it inside a token, eg. after the quote of a string */
+static void ej_push_sync(EJPushParser *parser) {
+  size_t i, offset = parser->buffer->offset;
+
+  for (i = 0; i < parser->n_tokens && parser->ends[i] <= offset; i++);
+  if (i > 0) {
+    parser->n_tokens -= i;
+    memmove(parser->starts, parser->starts + i, sizeof(size_t) * parser->n_tokens);
+    memmove(parser->ends, parser->ends + i, sizeof(size_t) * parser->n_tokens);
+  }
+
+  if ((parser->n_tokens > 0 && offset > parser->starts[0]) || offset > parser->lex_pos ||
+    (parser->lex_state != EJ_LEX_GAP && offset > parser->lex_start)) {
+    parser->n_tokens = 0;
+    parser->lex_state = EJ_LEX_GAP;
+    parser->lex_pos = offset;
+  }
+}
+
+static EJBool ej_push_ready(EJPushParser *parser) {
+  ej_push_sync(parser);
+  ej_push_lex(parser);
+
+  return parser->n_tokens == EJ_PUSH_LOOKAHEAD;
+}
+
+/* step as far as the buffered data allows, to the end when the stream is finished */
+static void ej_push_run(EJPushParser *parser, EJBool finish) {
+  EJBuffer *buffer = parser->buffer;
+
+  if (!parser->started) {
+    /* ej_skip_utf8_bom looks at four bytes */
+    if (!finish && !ej_valid(buffer, 4)) { return; }
+
+    ej_skip_utf8_bom(buffer);
+    parser->lex_pos = buffer->offset;
+    parser->started = true;
+  }
+
+  while (buffer->n_frames > 0) {
+    if (!finish && !ej_push_ready(parser)) { break; }
+
+    ej_step(buffer, &parser->ret, &parser->result);
+  }
+}
+
+/* drop the consumed head, its lines move into the buffer origin */
+static void ej_push_compact(EJPushParser *parser) {
+  EJBuffer *buffer = parser->buffer;
+  const EJString *p, *nl, *end = buffer->content + buffer->offset;
+  size_t i, n = buffer->offset, rows = 0;
+
+  if (n == 0) { return; }
+  ej_push_sync(parser);
+
+  for (p = buffer->content; p < end && (nl = memchr(p, '\n', (size_t)(end - p))) != NULL; p = nl + 1) {
+    rows++;
+  }
+  if (rows > 0) {
+    buffer->origin_row += rows;
+    buffer->origin_col = (size_t)(end - p);
+  }
+  else {
+    buffer->origin_col += n;
+  }
+
+  memmove(parser->data, parser->data + n, buffer->length - n);
+  buffer->length -= n;
+  buffer->offset = 0;
+
+  parser->lex_pos -= n;
+  parser->lex_start = parser->lex_start > n ? parser->lex_start - n : 0;
+  for (i = 0; i < parser->n_tokens; i++) {
+    parser->starts[i] -= n;
+    parser->ends[i] -= n;
+  }
+}
+
+EJ_MODULE_EXPORT(EJPushParser*) ej_push_parser_new(void) {
+  EJPushParser *parser = ej_new0(EJPushParser, 1);
+
+  parser->buffer = ej_buffer_mode_new("", 0, EJ_MODE_ITERATIVE);
+  parser->data = NULL;
+  parser->size = 0;
+  parser->ret = false;
+  parser->result = NULL;
+  parser->started = false;
+  parser->ended = false;
+  parser->lex_state = EJ_LEX_GAP;
+  parser->lex_pos = 0;
+  parser->lex_start = 0;
+  parser->n_tokens = 0;
+
+  ej_frame_call(parser->buffer, EJ_FRAME_VALUE);
+
+  return parser;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_push_feed(EJPushParser *parser, const EJString *data, size_t len) {
+  EJBuffer *buffer;
+  const EJString *nul;
+
+  ej_return_val_if_fail(parser != NULL && parser->buffer != NULL && (data != NULL || len == 0), false);
+
+  buffer = parser->buffer;
+  /* done, the rest is ignored or the error waits for ej_push_finish */
+  if (buffer->n_frames == 0) { return parser->ret; }
+  if (parser->ended || len == 0) { return true; }
+
+  /* ej_parse stops at the terminator */
+  nul = memchr(data, '\0', len);
+  if (nul != NULL) {
+    len = (size_t)(nul - data);
+    parser->ended = true;
+  }
+
+  ej_push_compact(parser);
+  /* a chunk that starts with the terminator has nothing to copy */
+  if (len > 0) {
+    if (buffer->length + len > parser->size) {
+      parser->size = MAX(parser->size * 2, buffer->length + len);
+      parser->data = ej_realloc(parser->data, parser->size);
+      buffer->content = parser->data;
+    }
+    memcpy(parser->data + buffer->length, data, len);
+    buffer->length += len;
+  }
+
+  ej_push_run(parser, false);
+
+  return buffer->n_frames > 0 || parser->ret;
+}
+
+EJ_MODULE_EXPORT(EJValue*) ej_push_finish(EJPushParser *parser, EJError **error) {
+  EJBuffer *buffer;
+  EJValue *value;
+
+  ej_return_val_if_fail(parser != NULL && parser->buffer != NULL, NULL);
+
+  buffer = parser->buffer;
+  ej_push_run(parser, true);
+
+  parser->buffer = NULL;
+  if (!ej_finish_buffer(buffer, parser->ret, error)) {
+    return NULL;
+  }
+
+  value = parser->result;
+  parser->result = NULL;
+  return value;
+}
+
+EJ_MODULE_EXPORT(void) ej_push_parser_free(EJPushParser *parser) {
+  EJBuffer *buffer;
+  EJError *error = NULL;
+
+  if (parser == NULL) { return; }
+
+  buffer = parser->buffer;
+  if (buffer != NULL) {
+    /* an unfinished parse runs out of data, its failure paths free the partial tree */
+    buffer->length = buffer->offset;
+    ej_push_run(parser, true);
+
+    if (!ej_finish_buffer(buffer, parser->ret, &error)) {
+      ej_free_error(error);
+    }
+    else {
+      ej_free_value(parser->result);
+    }
+  }
+
+  ej_free(parser->data);
+  ej_free(parser);
+}
+
+/* cursor, values are reached by skipping their siblings with bracket and
+ * quote matching, skipped subtrees are not validated. */
+typedef enum _EJ_SKIP_CLASS EJ_SKIP_CLASS;
+
+enum _EJ_SKIP_CLASS {
+  EJ_SKIP_NONE,
+  EJ_SKIP_OPEN,
+  EJ_SKIP_CLOSE,
+  EJ_SKIP_QUOTE,
+  EJ_SKIP_SLASH,
+};
+
+static const guint8 EJ_SKIP_CLASSES[256] = {
+  ['{'] = EJ_SKIP_OPEN, ['['] = EJ_SKIP_OPEN, ['<'] = EJ_SKIP_OPEN,
+  ['}'] = EJ_SKIP_CLOSE, [']'] = EJ_SKIP_CLOSE, ['>'] = EJ_SKIP_CLOSE,
+  ['"'] = EJ_SKIP_QUOTE, ['/'] = EJ_SKIP_SLASH,
+};
+
+/* pos is behind the opening quote, a quote behind an odd run of backslashes
+ * is escaped. returns the position behind the closing quote or 0. */
+static size_t ej_scan_skip_string(const EJString *content, size_t pos, size_t len) {
+  const EJString *q, *b;
+
+  while (pos < len && (q = memchr(content + pos, '"', len - pos)) != NULL) {
+    for (b = q; b > content + pos && b[-1] == '\\'; b--);
+
+    pos = (size_t)(q - content) + 1;
+    if ((q - b) % 2 == 0) { return pos; }
+  }
+
+  return 0;
+}
+
+/* pos is behind an opening bracket, returns the position behind its match or 0 */
+static size_t ej_scan_skip_nested(const EJString *content, size_t pos, size_t len) {
+  size_t depth = 1;
+  EJBool closed;
+
+  for (; pos < len; pos++) {
+    switch (EJ_SKIP_CLASSES[(guint8)content[pos]]) {
+      case EJ_SKIP_OPEN:
+        depth++;
+        break;
+      case EJ_SKIP_CLOSE:
+        if (--depth == 0) { return pos + 1; }
+        break;
+      case EJ_SKIP_QUOTE:
+        pos = ej_scan_skip_string(content, pos + 1, len);
+        if (pos == 0) { return 0; }
+        pos--;
+        break;
+      case EJ_SKIP_SLASH:
+        if (pos + 1 >= len) { return 0; }
+
+        if (content[pos + 1] == '/') {
+          pos = ej_scan_comment_line(content, pos + 2, len) - 1;
+        }
+        else if (content[pos + 1] == '*') {
+          pos = ej_scan_comment_multiple(content, pos + 2, len, &closed);
+          if (!closed) { return 0; }
+          pos--;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  return 0;
+}
+
+static EJ_TYPE ej_cursor_type_at(EJBuffer *buffer, size_t pos) {
+  buffer->offset = pos;
+  return ej_lex_value(buffer);
+}
+
+/* the position behind the value at pos, 0 when it can't be skipped */
+static size_t ej_cursor_skip_value(EJBuffer *buffer, size_t pos) {
+  const EJString *content = buffer->content;
+  size_t end, len = buffer->length;
+
+  buffer->offset = pos;
+  switch (ej_read_c_inner(buffer, 0)) {
+    case '"':
+      end = ej_scan_skip_string(content, pos + 1, len);
+      break;
+    case '{':
+    case '[':
+    case '<':
+      end = ej_scan_skip_nested(content, pos + 1, len);
+      break;
+    case '@':
+      ej_buffer_skip(buffer, 1);
+      end = ej_skip_whitespace(buffer) && ej_token_is(buffer, EJ_TOKEN_CUR_START) ?
+        ej_scan_skip_nested(content, buffer->offset + 1, len) : 0;
+      break;
+    default:
+      for (end = pos; end < len && ej_is_word_char(content[end]); end++);
+      if (end == pos) { end = 0; }
+      break;
+  }
+
+  if (end == 0) {
+    ej_set_error(buffer, "Skip value failed");
+  }
+  return end;
+}
+
+/* drop the error of an attempt that was recovered from, unless the buffer had failed before */
+static void ej_cursor_recovered(EJBuffer *buffer, EJBool clean) {
+  if (clean && buffer->error->message != NULL) {
+    ej_free(buffer->error->message);
+    buffer->error->message = NULL;
+  }
+}
+
+/* start and end of the key at pos with the fallbacks of ej_parse_key, a '@'
+ * key is parsed to find where its object ends or fails, a string which fails
+ * is read again as a bare key behind its quote. the errors of a recovered
+ * attempt are dropped. */
+static EJBool ej_cursor_scan_key(EJBuffer *buffer, size_t pos, size_t *start, size_t *end, EJBool *eobject) {
+  EJBool clean = buffer->error->message == NULL;
+  EJObject *obj;
+  size_t len, skip;
+
+  *eobject = false;
+  buffer->offset = pos;
+  if (ej_read_c_inner(buffer, 0) == '@') {
+    ej_buffer_skip(buffer, 1);
+
+    if (ej_parse_object(buffer, &obj)) {
+      if (buffer->arena == NULL) { ej_free_object(obj); }
+      *eobject = true;
+      *start = pos;
+      *end = buffer->offset;
+      goto success;
+    }
+  }
+
+  *start = buffer->offset;
+  if (ej_token_is(buffer, EJ_TOKEN_QMARK) && ej_scan_string(buffer, &len, &skip)) {
+    *end = buffer->offset + len + 1;
+    goto success;
+  }
+
+  len = ej_scan_key_without_quote(buffer);
+  if (len == 0) { return false; }
+
+  /* the scan may step over a comment */
+  *start = buffer->offset;
+  *end = buffer->offset + len;
+
+success:
+  ej_cursor_recovered(buffer, clean);
+  return true;
+}
+
+static void ej_cursor_at(EJBuffer *buffer, size_t pos, EJ_TYPE parent, EJCursor *cursor) {
+  cursor->buffer = buffer;
+  cursor->type = ej_cursor_type_at(buffer, pos);
+  cursor->offset = pos;
+  cursor->parent = parent;
+  cursor->key = 0;
+  cursor->props = 0;
+  cursor->is_key = false;
+}
+
+/* key, props and value of the member whose key starts at pos */
+static EJBool ej_cursor_member(EJBuffer *buffer, size_t pos, EJCursor *cursor) {
+  size_t props = 0, start, end;
+  EJBool eobject;
+
+  if (!ej_cursor_scan_key(buffer, pos, &start, &end, &eobject)) { return false; }
+
+  buffer->offset = end;
+  if (!ej_skip_whitespace(buffer)) { goto fail; }
+
+  if (ej_token_is(buffer, EJ_TOKEN_LT)) {
+    props = buffer->offset;
+    end = ej_scan_skip_nested(buffer->content, props + 1, buffer->length);
+    if (end == 0) {
+      ej_set_error(buffer, "Parse property failed");
+      return false;
+    }
+
+    buffer->offset = end;
+    if (!ej_skip_whitespace(buffer)) { goto fail; }
+  }
+
+  if (!ej_token_is(buffer, EJ_TOKEN_COLON)) {
+    ej_set_error(buffer, "Missing ':' before parse object value");
+    return false;
+  }
+  ej_buffer_skip(buffer, 1);
+  if (!ej_skip_whitespace(buffer)) { goto fail; }
+
+  ej_cursor_at(buffer, buffer->offset, EJ_OBJECT, cursor);
+  cursor->key = pos;
+  cursor->props = props;
+  return true;
+fail:
+  ej_set_error(buffer, "Occour buffer end when parse key.");
+  return false;
+}
+
+/* the first child from pos, which is behind an opening bracket or a comma,
+ * false without an error at the closing bracket */
+static EJBool ej_cursor_first(EJBuffer *buffer, size_t pos, EJ_TYPE parent, EJCursor *cursor) {
+  EJString c;
+
+  buffer->offset = pos;
+  if (!ej_skip_whitespace(buffer)) {
+    ej_set_error(buffer, "Occour buffer end when parse %s.", ej_get_data_type_name(parent));
+    return false;
+  }
+
+  c = ej_read_c_inner(buffer, 0);
+  if (c == '}' || c == ']' || c == '>') { return false; }
+
+  if (parent == EJ_OBJECT) {
+    return ej_cursor_member(buffer, buffer->offset, cursor);
+  }
+
+  ej_cursor_at(buffer, buffer->offset, parent, cursor);
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_init(EJCursor *cursor, EJBuffer *buffer) {
+  ej_return_val_if_fail(cursor != NULL && buffer != NULL, false);
+
+  buffer->offset = 0;
+  ej_skip_utf8_bom(buffer);
+  if (!ej_skip_whitespace(buffer)) {
+    ej_set_error(buffer, "Parse value failed");
+    return false;
+  }
+
+  ej_cursor_at(buffer, buffer->offset, EJ_INVALID, cursor);
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJ_TYPE) ej_cursor_type(const EJCursor *cursor) {
+  return cursor->type;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_enter(const EJCursor *cursor, EJCursor *child) {
+  EJBuffer *buffer = cursor->buffer;
+
+  switch (cursor->type) {
+    case EJ_ARRAY:
+      return ej_cursor_first(buffer, cursor->offset + 1, EJ_ARRAY, child);
+    case EJ_OBJECT:
+      return ej_cursor_first(buffer, cursor->offset + 1, EJ_OBJECT, child);
+    case EJ_EOBJECT:
+      buffer->offset = cursor->offset + 1;
+      if (!ej_skip_whitespace(buffer) || !ej_token_is(buffer, EJ_TOKEN_CUR_START)) {
+        ej_set_error(buffer, "Parse object failed");
+        return false;
+      }
+      return ej_cursor_first(buffer, buffer->offset + 1, EJ_OBJECT, child);
+    default:
+      return false;
+  }
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_next(EJCursor *cursor) {
+  EJBuffer *buffer = cursor->buffer;
+  EJCursor next;
+  size_t end;
+  EJString c;
+
+  if (cursor->parent == EJ_INVALID) { return false; }
+
+  end = ej_cursor_skip_value(buffer, cursor->offset);
+  if (end == 0) { return false; }
+
+  buffer->offset = end;
+  if (!ej_skip_whitespace(buffer)) {
+    ej_set_error(buffer, "Occour buffer end when parse %s.", ej_get_data_type_name(cursor->parent));
+    return false;
+  }
+
+  if (!ej_token_is(buffer, EJ_TOKEN_COMMA)) {
+    c = ej_read_c_inner(buffer, 0);
+    if (c != '}' && c != ']' && c != '>') {
+      ej_set_error(buffer, "Missing ',' before when parse %s", ej_get_data_type_name(cursor->parent));
+    }
+    return false;
+  }
+
+  if (!ej_cursor_first(buffer, buffer->offset + 1, cursor->parent, &next)) { return false; }
+
+  *cursor = next;
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_key(const EJCursor *cursor, EJCursor *key) {
+  EJBuffer *buffer = cursor->buffer;
+  size_t start, end;
+  EJBool eobject;
+
+  if (cursor->parent != EJ_OBJECT || cursor->is_key) { return false; }
+  if (!ej_cursor_scan_key(buffer, cursor->key, &start, &end, &eobject)) { return false; }
+
+  ej_cursor_at(buffer, start, EJ_INVALID, key);
+  key->type = eobject ? EJ_EOBJECT : EJ_STRING;
+  key->is_key = true;
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_props(const EJCursor *cursor, EJCursor *child) {
+  if (cursor->props == 0) { return false; }
+
+  return ej_cursor_first(cursor->buffer, cursor->props + 1, EJ_OBJECT, child);
+}
+
+/* compares without copying, escaped keys are decoded into the scratch buffer */
+static EJBool ej_cursor_key_is(const EJCursor *cursor, const EJString *key) {
+  EJBuffer *buffer = cursor->buffer;
+  const EJString *data;
+  size_t start, end, len;
+  EJBool eobject;
+
+  if (!ej_cursor_scan_key(buffer, cursor->key, &start, &end, &eobject) || eobject) { return false; }
+
+  buffer->offset = start;
+  if (ej_token_is(buffer, EJ_TOKEN_QMARK)) {
+    if (!ej_scan_string_slice(buffer, &data, &len)) { return false; }
+  }
+  else {
+    data = ej_read_inner(buffer, 0);
+    len = end - start;
+  }
+
+  return len == strlen(key) && memcmp(data, key, len) == 0;
+}
+
+static EJBool ej_cursor_find(EJCursor *it, const EJString *key, EJCursor *child) {
+  do {
+    if (ej_cursor_key_is(it, key)) {
+      *child = *it;
+      return true;
+    }
+  } while (ej_cursor_next(it));
+
+  return false;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_find_key(const EJCursor *cursor, const EJString *key, EJCursor *child) {
+  EJCursor it;
+
+  ej_return_val_if_fail(key != NULL && child != NULL, false);
+  if (cursor->type != EJ_OBJECT && cursor->type != EJ_EOBJECT) { return false; }
+  if (!ej_cursor_enter(cursor, &it)) { return false; }
+
+  return ej_cursor_find(&it, key, child);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_find_prop(const EJCursor *cursor, const EJString *key, EJCursor *child) {
+  EJCursor it;
+
+  ej_return_val_if_fail(key != NULL && child != NULL, false);
+  if (!ej_cursor_props(cursor, &it)) { return false; }
+
+  return ej_cursor_find(&it, key, child);
+}
+
+/* the string is a copy the caller owns, without flags the parsers neither
+ * decode in situ nor hand out the key table's keys */
+EJ_MODULE_EXPORT(EJBool) ej_cursor_get_string(const EJCursor *cursor, EJString **data) {
+  EJBuffer *buffer = cursor->buffer;
+  EJBool ret, clean = buffer->error->message == NULL;
+
+  ej_return_val_if_fail(data != NULL, false);
+  if (cursor->type != EJ_STRING) { return false; }
+
+  buffer->offset = cursor->offset;
+  if (ej_token_is(buffer, EJ_TOKEN_QMARK)) {
+    ret = ej_parse_string_inner(buffer, data, NULL, false);
+  }
+  else {
+    ret = ej_parse_key_without_quote(buffer, data);
+  }
+
+  if (ret) { ej_cursor_recovered(buffer, clean); }
+  return ret;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_get_number(const EJCursor *cursor, EJNumber *data) {
+  ej_return_val_if_fail(data != NULL, false);
+  if (cursor->type != EJ_NUMBER) { return false; }
+
+  cursor->buffer->offset = cursor->offset;
+  return ej_scan_number(cursor->buffer, data);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_cursor_get_bool(const EJCursor *cursor, EJBool *data) {
+  ej_return_val_if_fail(data != NULL, false);
+  if (cursor->type != EJ_BOOLEAN) { return false; }
+
+  cursor->buffer->offset = cursor->offset;
+  return ej_parse_bool(cursor->buffer, data);
+}
+
+/* builds the whole subtree, with the buffer's arena and key table */
+EJ_MODULE_EXPORT(EJBool) ej_cursor_get_value(const EJCursor *cursor, EJValue **data) {
+  EJBuffer *buffer = cursor->buffer;
+  EJBool ret, insitu = buffer->insitu, clean = buffer->error->message == NULL;
+
+  ej_return_val_if_fail(data != NULL, false);
+
+  buffer->offset = cursor->offset;
+  buffer->insitu = false;
+  if (cursor->is_key) {
+    ret = ej_parse_key(buffer, data);
+  }
+  else {
+    ret = ej_parse_value(buffer, data);
+  }
+  buffer->insitu = insitu;
+
+  if (ret) { ej_cursor_recovered(buffer, clean); }
+  return ret;
+}
+
+/* parallel mode, the children of a large top level container are split at its
+ * own commas into chunks which are parsed by a pool. every chunk is parsed the
+ * way ej_parse_array_inner / ej_parse_object_inner would from its start and has
+ * to end right at the next split, so the children are the same as parsing them
+ * in one go. the whole value is parsed again serially when any chunk does not. */
+typedef struct _EJChunk EJChunk;
+
+struct _EJChunk {
+  const EJString *content;
+  size_t length;
+  EJKeyTable *keys;
+  EJParseOptions options;
+  EJ_TYPE type;
+  /* behind the opening bracket or a split, up to the next split */
+  size_t start;
+  size_t end;
+  EJBool last;
+  EJBool ret;
+  /* for the last chunk, the closing bracket */
+  size_t offset;
+  GPtrArray *children;
+};
+
+/* commas of the container whose children start at pos, step bytes apart at least */
+static size_t *ej_parallel_split(const EJString *content, size_t pos, size_t len, size_t step, size_t *n_splits) {
+  size_t *splits = NULL, size_splits = 0, next = pos + step;
+  EJBool closed;
+
+  *n_splits = 0;
+  for (; pos < len; pos++) {
+    switch (EJ_SKIP_CLASSES[(guint8)content[pos]]) {
+      case EJ_SKIP_OPEN:
+        pos = ej_scan_skip_nested(content, pos + 1, len);
+        if (pos == 0) { return splits; }
+        pos--;
+        break;
+      case EJ_SKIP_CLOSE:
+        return splits;
+      case EJ_SKIP_QUOTE:
+        pos = ej_scan_skip_string(content, pos + 1, len);
+        if (pos == 0) { return splits; }
+        pos--;
+        break;
+      case EJ_SKIP_SLASH:
+        if (pos + 1 >= len) { return splits; }
+
+        if (content[pos + 1] == '/') {
+          pos = ej_scan_comment_line(content, pos + 2, len) - 1;
+        }
+        else if (content[pos + 1] == '*') {
+          pos = ej_scan_comment_multiple(content, pos + 2, len, &closed);
+          if (!closed) { return splits; }
+          pos--;
+        }
+        break;
+      default:
+        if (content[pos] == ',' && pos >= next) {
+          if (*n_splits == size_splits) {
+            size_splits = size_splits > 0 ? size_splits * 2 : 64;
+            splits = ej_realloc(splits, sizeof(size_t) * size_splits);
+          }
+          splits[(*n_splits)++] = pos;
+          next = pos + step;
+        }
+        break;
+    }
+  }
+
+  return splits;
+}
+
+/* ej_dialect_array from behind the '[' or a ','. a chunk is never the whole
+ * container, so its ']' at the start is behind a trailing comma */
+static EJBool ej_parallel_array(EJBuffer *buffer, EJChunk *chunk) {
+  EJParseOptions options = buffer->options;
+  EJValue *value = NULL;
+
+  while (true) {
+    if (ej_dialect_ensure_char(buffer, EJ_TOKEN_BKT_END, options)) {
+      return chunk->last && (options & EJ_PARSE_TRAILING_COMMAS);
+    }
+
+    if (!ej_parse_value(buffer, &value)) { return false; }
+    ej_buffer_stack_push(buffer, value);
+
+    if (ej_dialect_ensure_char(buffer, EJ_TOKEN_COMMA, options)) {
+      if (!chunk->last && buffer->offset >= chunk->end) { return buffer->offset == chunk->end; }
+      ej_buffer_skip(buffer, 1);
+    }
+    else {
+      return chunk->last && ej_token_is(buffer, EJ_TOKEN_BKT_END);
+    }
+  }
+}
+
+/* ej_dialect_object from behind the '{' or a ',' */
+static EJBool ej_parallel_object(EJBuffer *buffer, EJChunk *chunk) {
+  EJParseOptions options = buffer->options;
+  EJObjectPair *pair = NULL;
+
+  if (!ej_dialect_skip_whitespace(buffer, options)) { return false; }
+  if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) { return chunk->last && (options & EJ_PARSE_TRAILING_COMMAS); }
+
+  while (true) {
+    if (!ej_parse_object_pair(buffer, NULL, &pair)) { return false; }
+
+    if (!ej_dialect_skip_whitespace(buffer, options)) {
+      ej_free_object_pair(pair);
+      return false;
+    }
+    ej_buffer_stack_push(buffer, pair);
+
+    if (ej_token_is(buffer, EJ_TOKEN_COMMA)) {
+      if (!chunk->last && buffer->offset >= chunk->end) { return buffer->offset == chunk->end; }
+      ej_buffer_skip(buffer, 1);
+
+      if (!ej_dialect_skip_whitespace(buffer, options)) { return false; }
+      if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) { return chunk->last && (options & EJ_PARSE_TRAILING_COMMAS); }
+    }
+    else {
+      return chunk->last && ej_token_is(buffer, EJ_TOKEN_CUR_END);
+    }
+  }
+}
+
+static void ej_parallel_run(gpointer data, gpointer user_data) {
+  EJChunk *chunk = data;
+  EJBuffer *buffer = ej_buffer_new(chunk->content, chunk->length);
+
+  buffer->keys = chunk->keys;
+  buffer->options = chunk->options;
+  buffer->offset = chunk->start;
+  if (chunk->type == EJ_ARRAY) {
+    chunk->ret = ej_parallel_array(buffer, chunk);
+  }
+  else {
+    chunk->ret = ej_parallel_object(buffer, chunk);
+  }
+  chunk->offset = buffer->offset;
+
+  chunk->children = buffer->stack;
+  buffer->stack = ej_ptr_array_new();
+  /* a failed chunk is parsed again, the serial parse reports the error */
+  if (buffer->error->message != NULL) {
+    ej_free(buffer->error->message);
+    buffer->error->message = NULL;
+  }
+  ej_free_buffer(buffer);
+}
+
+/* the container at the offset, false when it is too small to split or a chunk failed */
+static EJBool ej_parallel_container(EJBuffer *buffer, EJ_TYPE type, EJArray **data) {
+  GDestroyNotify func = type == EJ_ARRAY ? (GDestroyNotify)ej_free_value : (GDestroyNotify)ej_free_object_pair;
+  guint n_threads = buffer->n_threads > 0 ? buffer->n_threads : ej_get_num_processors();
+  size_t *splits, n_splits, n_chunks, total = 0, i, j;
+  size_t open = buffer->offset, step;
+  EJChunk *chunks;
+  GThreadPool *pool;
+  EJBool ret = true;
+
+  if (n_threads < 2) { return false; }
+
+  step = MAX(EJ_PARALLEL_MIN_CHUNK, (buffer->length - open) / (n_threads * EJ_PARALLEL_CHUNKS_PER_THREAD));
+  splits = ej_parallel_split(buffer->content, open + 1, buffer->length, step, &n_splits);
+  if (n_splits == 0) {
+    ej_free(splits);
+    return false;
+  }
+
+  n_chunks = n_splits + 1;
+  chunks = ej_new0(EJChunk, n_chunks);
+  pool = ej_thread_pool_new(ej_parallel_run, NULL, n_threads, false);
+  for (i = 0; i < n_chunks; i++) {
+    chunks[i].content = buffer->content;
+    chunks[i].length = buffer->length;
+    chunks[i].keys = buffer->keys;
+    chunks[i].options = buffer->options;
+    chunks[i].type = type;
+    chunks[i].start = i == 0 ? open + 1 : splits[i - 1] + 1;
+    chunks[i].end = i < n_splits ? splits[i] : buffer->length;
+    chunks[i].last = i == n_splits;
+    ej_thread_pool_push(pool, &chunks[i]);
+  }
+  /* waits for every chunk */
+  ej_thread_pool_free(pool, false, true);
+
+  for (i = 0; i < n_chunks; i++) {
+    ret = ret && chunks[i].ret;
+    total += chunks[i].children->len;
+  }
+
+  if (ret) {
+    *data = ej_ptr_array_new_full((guint)total, func);
+    for (i = 0; i < n_chunks; i++) {
+      for (j = 0; j < chunks[i].children->len; j++) {
+        ej_ptr_array_add(*data, chunks[i].children->pdata[j]);
+      }
+    }
+    buffer->offset = chunks[n_splits].offset;
+    ej_buffer_skip(buffer, 1);
+  }
+
+  for (i = 0; i < n_chunks; i++) {
+    if (!ret) {
+      for (j = 0; j < chunks[i].children->len; j++) {
+        func(chunks[i].children->pdata[j]);
+      }
+    }
+    ej_free_ptr_array(chunks[i].children);
+  }
+  ej_free(chunks);
+  ej_free(splits);
+
+  return ret;
+}
+
+/* an arena is not shared between threads and an in situ buffer may have been
+ * decoded by a failed chunk, those are parsed serially */
+static EJBool ej_parse_value_parallel(EJBuffer *buffer, EJValue **data) {
+  size_t start = buffer->offset;
+  EJBool ret, clean = buffer->error->message == NULL;
+  EJValue *value;
+  EJ_TYPE type;
+
+  buffer->mode = EJ_MODE_RECURSIVE;
+
+  if (buffer->arena == NULL && !buffer->insitu && ej_dialect_skip_whitespace(buffer, buffer->options)
+      && (ej_token_is(buffer, EJ_TOKEN_BKT_START) || ej_token_is(buffer, EJ_TOKEN_CUR_START))) {
+    type = ej_token_is(buffer, EJ_TOKEN_BKT_START) ? EJ_ARRAY : EJ_OBJECT;
+    value = ej_new0(EJValue, 1);
+    value->type = type;
+
+    if (ej_parallel_container(buffer, type, &value->v.array)) {
+      *data = value;
+      buffer->mode = EJ_MODE_PARALLEL;
+      return true;
+    }
+    ej_free(value);
+
+    if (clean && buffer->error->message != NULL) {
+      ej_free(buffer->error->message);
+      buffer->error->message = NULL;
+    }
+  }
+  buffer->offset = start;
+
+  ret = ej_parse_value(buffer, data);
+  buffer->mode = EJ_MODE_PARALLEL;
+
+  return ret;
+}
+
+/* document, the events of ej_parse_events written to a tape. while a container
+ * is open its begin word counts its keys and values, props are not counted */
+static size_t ej_document_push(EJDocument *doc, guint64 word) {
+  if (doc->n_tape == doc->size_tape) {
+    doc->size_tape = doc->size_tape > 0 ? doc->size_tape * 2 : 256;
+    doc->tape = ej_realloc(doc->tape, sizeof(guint64) * doc->size_tape);
+  }
+
+  doc->tape[doc->n_tape] = word;
+  return doc->n_tape++;
+}
+
+static size_t ej_document_child(EJDocument *doc, guint64 word) {
+  if (doc->n_open > 0 && EJ_TAPE_TAG(word) != EJ_TAPE_PROPS) {
+    doc->tape[doc->open[doc->n_open - 1]]++;
+  }
+
+  return ej_document_push(doc, word);
+}
+
+static EJBool ej_document_begin(EJDocument *doc, guint tag) {
+  size_t begin;
+
+  if (doc->n_open == doc->size_open) {
+    doc->size_open = doc->size_open > 0 ? doc->size_open * 2 : 32;
+    doc->open = ej_realloc(doc->open, sizeof(size_t) * doc->size_open);
+  }
+
+  if (tag == EJ_OBJECT && doc->eobject) {
+    tag = EJ_EOBJECT;
+    doc->eobject = false;
+  }
+
+  begin = ej_document_child(doc, EJ_TAPE_WORD(tag, 0));
+  doc->open[doc->n_open++] = begin;
+  return true;
+}
+
+static EJBool ej_document_end(EJDocument *doc) {
+  size_t begin = doc->open[--doc->n_open];
+  guint tag = EJ_TAPE_TAG(doc->tape[begin]);
+  size_t count = EJ_TAPE_PAYLOAD(doc->tape[begin]);
+
+  doc->tape[begin] = EJ_TAPE_WORD(tag, doc->n_tape);
+  ej_document_push(doc, EJ_TAPE_WORD(EJ_TAPE_END, tag == EJ_ARRAY ? count : count / 2));
+  return true;
+}
+
+static EJBool ej_document_string(EJDocument *doc, const EJString *data, size_t len) {
+  guint32 len32 = (guint32)len;
+  size_t need = doc->n_strings + sizeof(guint32) + len + 1;
+
+  if (need > doc->size_strings) {
+    doc->size_strings = MAX(need, doc->size_strings * 2);
+    doc->strings = ej_realloc(doc->strings, doc->size_strings);
+  }
+
+  ej_document_child(doc, EJ_TAPE_WORD(EJ_STRING, doc->n_strings));
+  memcpy(doc->strings + doc->n_strings, &len32, sizeof(guint32));
+  memcpy(doc->strings + doc->n_strings + sizeof(guint32), data, len);
+  doc->strings[doc->n_strings + sizeof(guint32) + len] = '\0';
+  doc->n_strings = need;
+  return true;
+}
+
+static EJBool ej_document_begin_object(gpointer user_data) {
+  return ej_document_begin(user_data, EJ_OBJECT);
+}
+
+static EJBool ej_document_begin_array(gpointer user_data) {
+  return ej_document_begin(user_data, EJ_ARRAY);
+}
+
+static EJBool ej_document_begin_props(gpointer user_data) {
+  return ej_document_begin(user_data, EJ_TAPE_PROPS);
+}
+
+static EJBool ej_document_end_any(gpointer user_data) {
+  return ej_document_end(user_data);
+}
+
+static EJBool ej_document_eobject(gpointer user_data) {
+  ((EJDocument *)user_data)->eobject = true;
+  return true;
+}
+
+static EJBool ej_document_on_string(const EJString *data, size_t len, gpointer user_data) {
+  return ej_document_string(user_data, data, len);
+}
+
+static EJBool ej_document_number(const EJNumber *data, gpointer user_data) {
+  EJDocument *doc = user_data;
+  gint64 i = data->v.i;
+  guint64 bits;
+
+  if (data->type == EJ_INT) {
+    memcpy(&bits, &i, sizeof(bits));
+  }
+  else {
+    memcpy(&bits, &data->v.d, sizeof(bits));
+  }
+
+  ej_document_child(doc, EJ_TAPE_WORD(EJ_NUMBER, data->type));
+  ej_document_push(doc, bits);
+  return true;
+}
+
+static EJBool ej_document_boolean(EJBool data, gpointer user_data) {
+  ej_document_child(user_data, EJ_TAPE_WORD(EJ_BOOLEAN, data ? 1 : 0));
+  return true;
+}
+
+static EJBool ej_document_null(gpointer user_data) {
+  ej_document_child(user_data, EJ_TAPE_WORD(EJ_NULL, 0));
+  return true;
+}
+
+static const EJHandler ej_document_handler = {
+  ej_document_begin_object, ej_document_end_any,
+  ej_document_begin_array, ej_document_end_any,
+  ej_document_begin_props, ej_document_end_any,
+  ej_document_eobject, ej_document_on_string, ej_document_on_string,
+  ej_document_number, ej_document_boolean, ej_document_null
+};
+
+EJ_MODULE_EXPORT(EJDocument*) ej_parse_document(EJError **error, const EJString *content) {
+  EJDocument *doc = ej_new0(EJDocument, 1);
+
+  if (!ej_parse_events(&ej_document_handler, doc, error, content)) {
+    ej_free(doc->open);
+    ej_document_free(doc);
+    return NULL;
+  }
+
+  ej_free(doc->open);
+  doc->open = NULL;
+  doc->size_open = 0;
+  /* the tape is not written any more, give back the growth room */
+  doc->tape = ej_realloc(doc->tape, sizeof(guint64) * doc->n_tape);
+  doc->size_tape = doc->n_tape;
+  if (doc->n_strings > 0) {
+    doc->strings = ej_realloc(doc->strings, doc->n_strings);
+    doc->size_strings = doc->n_strings;
+  }
+
+  return doc;
+}
+
+EJ_MODULE_EXPORT(size_t) ej_document_size(const EJDocument *doc) {
+  ej_return_val_if_fail(doc != NULL, 0);
+
+  return sizeof(EJDocument) + sizeof(guint64) * doc->size_tape + doc->size_strings;
+}
+
+EJ_MODULE_EXPORT(void) ej_document_free(EJDocument *doc) {
+  if (doc == NULL) { return; }
+
+  ej_free(doc->tape);
+  ej_free(doc->strings);
+  ej_free(doc);
+}
+
+/* the index behind the value, key or props at i */
+static size_t ej_tape_skip(const EJDocument *doc, size_t i) {
+  switch (EJ_TAPE_TAG(doc->tape[i])) {
+    case EJ_NUMBER:
+      return i + 2;
+    case EJ_ARRAY:
+    case EJ_OBJECT:
+    case EJ_EOBJECT:
+    case EJ_TAPE_PROPS:
+      return EJ_TAPE_PAYLOAD(doc->tape[i]) + 1;
+    default:
+      return i + 1;
+  }
+}
+
+/* the child at i, false at the end word of the parent */
+static EJBool ej_tape_at(const EJDocument *doc, size_t i, EJ_TYPE parent, EJTape *tape) {
+  if (EJ_TAPE_TAG(doc->tape[i]) == EJ_TAPE_END) { return false; }
+
+  tape->document = doc;
+  tape->parent = parent;
+  tape->key = 0;
+  tape->props = 0;
+
+  if (parent == EJ_OBJECT) {
+    tape->key = i;
+    i = ej_tape_skip(doc, i);
+    if (EJ_TAPE_TAG(doc->tape[i]) == EJ_TAPE_PROPS) {
+      tape->props = i;
+      i = ej_tape_skip(doc, i);
+    }
+  }
+
+  tape->index = i;
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_document_root(const EJDocument *doc, EJTape *tape) {
+  ej_return_val_if_fail(doc != NULL && tape != NULL, false);
+
+  return ej_tape_at(doc, 0, EJ_INVALID, tape);
+}
+
+EJ_MODULE_EXPORT(EJ_TYPE) ej_tape_type(const EJTape *tape) {
+  return EJ_TAPE_TAG(tape->document->tape[tape->index]);
+}
+
+/* members, elements or children */
+EJ_MODULE_EXPORT(size_t) ej_tape_count(const EJTape *tape) {
+  const EJDocument *doc = tape->document;
+
+  switch (ej_tape_type(tape)) {
+    case EJ_ARRAY:
+    case EJ_OBJECT:
+    case EJ_EOBJECT:
+      return EJ_TAPE_PAYLOAD(doc->tape[EJ_TAPE_PAYLOAD(doc->tape[tape->index])]);
+    default:
+      return 0;
+  }
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_tape_enter(const EJTape *tape, EJTape *child) {
+  switch (ej_tape_type(tape)) {
+    case EJ_ARRAY:
+      return ej_tape_at(tape->document, tape->index + 1, EJ_ARRAY, child);
+    case EJ_OBJECT:
+    case EJ_EOBJECT:
+      return ej_tape_at(tape->document, tape->index + 1, EJ_OBJECT, child);
+    default:
+      return false;
+  }
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_tape_next(EJTape *tape) {
+  if (tape->parent == EJ_INVALID) { return false; }
+
+  return ej_tape_at(tape->document, ej_tape_skip(tape->document, tape->index), tape->parent, tape);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_tape_key(const EJTape *tape, EJTape *key) {
+  if (tape->key == 0) { return false; }
+
+  key->document = tape->document;
+  key->index = tape->key;
+  key->parent = EJ_INVALID;
+  key->key = 0;
+  key->props = 0;
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_tape_props(const EJTape *tape, EJTape *child) {
+  if (tape->props == 0) { return false; }
+
+  return ej_tape_at(tape->document, tape->props + 1, EJ_OBJECT, child);
+}
+
+static const EJString *ej_tape_string_at(const EJDocument *doc, size_t i, size_t *len) {
+  const EJString *data = doc->strings + EJ_TAPE_PAYLOAD(doc->tape[i]);
+  guint32 len32;
+
+  memcpy(&len32, data, sizeof(guint32));
+  if (len != NULL) { *len = len32; }
+  return data + sizeof(guint32);
+}
+
+static EJBool ej_tape_find(EJTape *it, const EJString *key, EJTape *child) {
+  const EJString *data;
+  size_t len, klen = strlen(key);
+
+  do {
+    if (EJ_TAPE_TAG(it->document->tape[it->key]) != EJ_STRING) { continue; }
+
+    data = ej_tape_string_at(it->document, it->key, &len);
+    if (len == klen && memcmp(data, key, len) == 0) {
+      *child = *it;
+      return true;
+    }
+  } while (ej_tape_next(it));
+
+  return false;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_tape_find_key(const EJTape *tape, const EJString *key, EJTape *child) {
+  EJTape it;
+
+  ej_return_val_if_fail(key != NULL && child != NULL, false);
+  if (ej_tape_type(tape) != EJ_OBJECT && ej_tape_type(tape) != EJ_EOBJECT) { return false; }
+  if (!ej_tape_enter(tape, &it)) { return false; }
+
+  return ej_tape_find(&it, key, child);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_tape_find_prop(const EJTape *tape, const EJString *key, EJTape *child) {
+  EJTape it;
+
+  ej_return_val_if_fail(key != NULL && child != NULL, false);
+  if (!ej_tape_props(tape, &it)) { return false; }
+
+  return ej_tape_find(&it, key, child);
+}
+
+/* points into the document, len may be NULL */
+EJ_MODULE_EXPORT(const EJString*) ej_tape_get_string(const EJTape *tape, size_t *len) {
+  if (ej_tape_type(tape) != EJ_STRING) { return NULL; }
+
+  return ej_tape_string_at(tape->document, tape->index, len);
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_tape_get_number(const EJTape *tape, EJNumber *data) {
+  guint64 bits;
+  gint64 i;
+
+  ej_return_val_if_fail(data != NULL, false);
+  if (ej_tape_type(tape) != EJ_NUMBER) { return false; }
+
+  bits = tape->document->tape[tape->index + 1];
+  data->type = (EJ_NUMBER_TYPE)EJ_TAPE_PAYLOAD(tape->document->tape[tape->index]);
+  if (data->type == EJ_INT) {
+    memcpy(&i, &bits, sizeof(i));
+    data->v.i = (int)i;
+  }
+  else {
+    memcpy(&data->v.d, &bits, sizeof(bits));
+  }
+  return true;
+}
+
+EJ_MODULE_EXPORT(EJBool) ej_tape_get_bool(const EJTape *tape, EJBool *data) {
+  ej_return_val_if_fail(data != NULL, false);
+  if (ej_tape_type(tape) != EJ_BOOLEAN) { return false; }
+
+  *data = EJ_TAPE_PAYLOAD(tape->document->tape[tape->index]) != 0;
+  return true;
+}
+
+/* members of the object, '@' object or props whose begin word is at begin */
+static EJArray *ej_tape_members_to_value(const EJDocument *doc, size_t begin) {
+  EJArray *arr = ej_ptr_array_new_full(EJ_TAPE_PAYLOAD(doc->tape[EJ_TAPE_PAYLOAD(doc->tape[begin])]), ej_free_object_pair);
+  EJTape it, key;
+  EJObjectPair *pair;
+
+  if (!ej_tape_at(doc, begin + 1, EJ_OBJECT, &it)) { return arr; }
+
+  do {
+    pair = ej_object_pair_new();
+    ej_tape_key(&it, &key);
+    pair->key = ej_tape_to_value(&key);
+    if (it.props != 0) {
+      pair->props = ej_tape_members_to_value(doc, it.props);
+    }
+    pair->value = ej_tape_to_value(&it);
+    ej_ptr_array_add(arr, pair);
+  } while (ej_tape_next(&it));
+
+  return arr;
+}
+
+/* a tree of its own, the same as ej_parse builds for the value */
+EJ_MODULE_EXPORT(EJValue*) ej_tape_to_value(const EJTape *tape) {
+  EJValue *value = ej_new0(EJValue, 1);
+  const EJString *str;
+  EJTape it;
+  size_t len;
+
+  value->type = ej_tape_type(tape);
+  switch (value->type) {
+    case EJ_STRING:
+      str = ej_tape_get_string(tape, &len);
+      value->v.string = ej_strndup(str, len);
+      break;
+    case EJ_NUMBER:
+      value->v.number = ej_new0(EJNumber, 1);
+      ej_tape_get_number(tape, value->v.number);
+      break;
+    case EJ_BOOLEAN:
+      ej_tape_get_bool(tape, &value->v.bvalue);
+      break;
+    case EJ_ARRAY:
+      value->v.array = ej_ptr_array_new_full(ej_tape_count(tape), ej_free_value);
+      if (ej_tape_enter(tape, &it)) {
+        do {
+          ej_ptr_array_add(value->v.array, ej_tape_to_value(&it));
+        } while (ej_tape_next(&it));
+      }
+      break;
+    case EJ_OBJECT:
+    case EJ_EOBJECT:
+      value->v.object = ej_tape_members_to_value(tape->document, tape->index);
+      break;
+    default:
+      break;
+  }
+
+  return value;
+}
+
+/* transcode, the events of ej_parse_events written as standard json in the
+ * layout of the ReadMe. a pair with props becomes a node with "properties" and
+ * "children", every pair of the object a node holds becomes a node with a
+ * "name" too. nothing of the document is kept but the pending key of every
+ * open object. */
+typedef enum _EJ_TRANSCODE_FRAME EJ_TRANSCODE_FRAME;
+
+enum _EJ_TRANSCODE_FRAME {
+  EJ_TRANSCODE_ARRAY,
+  EJ_TRANSCODE_OBJECT,
+  /* the object of a node, written as an array of nodes */
+  EJ_TRANSCODE_CHILDREN,
+  /* written as the one object in "properties", or nothing when empty */
+  EJ_TRANSCODE_PROPS,
+};
+
+typedef enum _EJ_TRANSCODE_STATE EJ_TRANSCODE_STATE;
+
+enum _EJ_TRANSCODE_STATE {
+  EJ_TRANSCODE_KEY,
+  /* the key is pending until props or the value show what the pair is */
+  EJ_TRANSCODE_PENDING,
+  /* a node whose "properties" are written */
+  EJ_TRANSCODE_PROPS_DONE,
+  EJ_TRANSCODE_VALUE,
+};
+
+typedef struct _EJTranscodeFrame EJTranscodeFrame;
+
+struct _EJTranscodeFrame {
+  EJ_TRANSCODE_FRAME type;
+  EJ_TRANSCODE_STATE state;
+  EJBool first;
+  /* the pair being written is a node, it is closed after its value */
+  EJBool node;
+  /* an @ value, closed twice */
+  EJBool eobject;
+  /* the sink written before an @ key was, NULL when none is */
+  EJSink *saved;
+  /* these are kept when the frame is popped, the next one at its depth reuses them,
+   * an @ key is written into captured through capture */
+  GString *key;
+  GString *captured;
+  EJSink *capture;
+};
+
+typedef struct _EJTranscoder EJTranscoder;
+
+struct _EJTranscoder {
+  /* the sink being written, a capture while an @ key is */
+  EJSink *out;
+  EJTranscodeFrame *frames;
+  size_t n_frames;
+  size_t size_frames;
+  EJBool eobject;
+};
+
+static EJTranscodeFrame *ej_transcode_top(EJTranscoder *t) {
+  return t->n_frames > 0 ? &t->frames[t->n_frames - 1] : NULL;
+}
+
+static EJTranscodeFrame *ej_transcode_push(EJTranscoder *t, EJ_TRANSCODE_FRAME type) {
+  EJTranscodeFrame *frame;
+
+  if (t->n_frames == t->size_frames) {
+    t->size_frames = t->size_frames > 0 ? t->size_frames * 2 : 32;
+    t->frames = ej_realloc(t->frames, sizeof(EJTranscodeFrame) * t->size_frames);
+    memset(t->frames + t->n_frames, 0, sizeof(EJTranscodeFrame) * (t->size_frames - t->n_frames));
+  }
+
+  frame = &t->frames[t->n_frames++];
+  frame->type = type;
+  frame->state = EJ_TRANSCODE_KEY;
+  frame->first = true;
+  frame->node = false;
+  frame->eobject = false;
+  frame->saved = NULL;
+
+  return frame;
+}
+
+/* the start of a pair whose key was pending, node when props follow */
+static void ej_transcode_pair_head(EJTranscoder *t, EJTranscodeFrame *frame, EJBool node) {
+  if (frame->type == EJ_TRANSCODE_PROPS && frame->first) {
+    ej_sink_append_c(t->out, '{');
+  }
+  else if (!frame->first) {
+    ej_sink_append_c(t->out, ',');
+  }
+  frame->first = false;
+
+  if (frame->type == EJ_TRANSCODE_CHILDREN) {
+    ej_sink_append_str(t->out, "{\"name\":");
+    ej_sink_append_escaped(t->out, frame->key->str, frame->key->len);
+    ej_sink_append_str(t->out, ",\"properties\":[");
+  }
+  else {
+    ej_sink_append_escaped(t->out, frame->key->str, frame->key->len);
+    ej_sink_append_c(t->out, ':');
+    if (node) { ej_sink_append_str(t->out, "{\"properties\":["); }
+  }
+  frame->node = node || frame->type == EJ_TRANSCODE_CHILDREN;
+}
+
+/* before any value, returns whether an object starting here holds nodes */
+static EJBool ej_transcode_value_begin(EJTranscoder *t, EJ_TYPE type) {
+  EJTranscodeFrame *frame = ej_transcode_top(t);
+
+  if (frame == NULL) { return false; }
+
+  if (frame->type == EJ_TRANSCODE_ARRAY) {
+    if (!frame->first) { ej_sink_append_c(t->out, ','); }
+    frame->first = false;
+    return false;
+  }
+
+  if (frame->state == EJ_TRANSCODE_PENDING) {
+    ej_transcode_pair_head(t, frame, false);
+  }
+  frame->state = EJ_TRANSCODE_VALUE;
+
+  if (!frame->node) { return false; }
+
+  /* the properties of a node without props are empty */
+  ej_sink_append_str(t->out, "],");
+  if (type == EJ_OBJECT || type == EJ_ARRAY) {
+    ej_sink_append_str(t->out, "\"children\":");
+    return type == EJ_OBJECT;
+  }
+  ej_sink_append_str(t->out, "\"value\":");
+  return false;
+}
+
+static EJBool ej_transcode_value_end(EJTranscoder *t) {
+  EJTranscodeFrame *frame = ej_transcode_top(t);
+
+  if (frame != NULL && frame->type != EJ_TRANSCODE_ARRAY) {
+    if (frame->node) { ej_sink_append_c(t->out, '}'); }
+    frame->node = false;
+    frame->state = EJ_TRANSCODE_KEY;
+  }
+
+  return !t->out->failed;
+}
+
+static EJBool ej_transcode_begin_object(gpointer user_data) {
+  EJTranscoder *t = user_data;
+  EJTranscodeFrame *frame = ej_transcode_top(t);
+  EJBool children, eobject = t->eobject;
+
+  t->eobject = false;
+
+  /* an @ key is written into a string sink of its own */
+  if (eobject && frame != NULL && frame->type != EJ_TRANSCODE_ARRAY && frame->state == EJ_TRANSCODE_KEY) {
+    if (frame->captured == NULL) {
+      frame->captured = ej_string_new("");
+      frame->capture = ej_sink_new(ej_sink_string_write, NULL, frame->captured, 256);
+    }
+    ej_string_truncate(frame->captured, 0);
+    frame->saved = t->out;
+    t->out = frame->capture;
+    ej_sink_append_c(t->out, '@');
+
+    frame = ej_transcode_push(t, EJ_TRANSCODE_OBJECT);
+    ej_sink_append_c(t->out, '{');
+    return true;
+  }
+
+  children = ej_transcode_value_begin(t, eobject ? EJ_EOBJECT : EJ_OBJECT);
+  if (eobject) {
+    ej_sink_append_str(t->out, "{\"@\":");
+  }
+
+  frame = ej_transcode_push(t, children ? EJ_TRANSCODE_CHILDREN : EJ_TRANSCODE_OBJECT);
+  frame->eobject = eobject;
+  ej_sink_append_c(t->out, children ? '[' : '{');
+
+  return !t->out->failed;
+}
+
+static EJBool ej_transcode_end_object(gpointer user_data) {
+  EJTranscoder *t = user_data;
+  EJTranscodeFrame *frame = &t->frames[--t->n_frames];
+  EJTranscodeFrame *parent = ej_transcode_top(t);
+
+  ej_sink_append_c(t->out, frame->type == EJ_TRANSCODE_CHILDREN ? ']' : '}');
+  if (frame->eobject) { ej_sink_append_c(t->out, '}'); }
+
+  if (parent != NULL && parent->saved != NULL && t->out == parent->capture) {
+    /* the @ key is complete, it is pending like a string key */
+    ej_sink_drain(t->out);
+    t->out = parent->saved;
+    parent->saved = NULL;
+    if (parent->key == NULL) { parent->key = ej_string_new(""); }
+    ej_string_truncate(parent->key, 0);
+    ej_string_append_len(parent->key, parent->captured->str, parent->captured->len);
+    parent->state = EJ_TRANSCODE_PENDING;
+    return true;
+  }
+
+  return ej_transcode_value_end(t);
+}
+
+static EJBool ej_transcode_begin_array(gpointer user_data) {
+  EJTranscoder *t = user_data;
+
+  ej_transcode_value_begin(t, EJ_ARRAY);
+  ej_transcode_push(t, EJ_TRANSCODE_ARRAY);
+  ej_sink_append_c(t->out, '[');
+
+  return !t->out->failed;
+}
+
+static EJBool ej_transcode_end_array(gpointer user_data) {
+  EJTranscoder *t = user_data;
+
+  t->n_frames--;
+  ej_sink_append_c(t->out, ']');
+
+  return ej_transcode_value_end(t);
+}
+
+static EJBool ej_transcode_begin_props(gpointer user_data) {
+  EJTranscoder *t = user_data;
+
+  ej_transcode_pair_head(t, ej_transcode_top(t), true);
+  ej_transcode_push(t, EJ_TRANSCODE_PROPS);
+
+  return !t->out->failed;
+}
+
+static EJBool ej_transcode_end_props(gpointer user_data) {
+  EJTranscoder *t = user_data;
+  EJTranscodeFrame *frame = &t->frames[--t->n_frames];
+
+  if (!frame->first) { ej_sink_append_c(t->out, '}'); }
+  ej_transcode_top(t)->state = EJ_TRANSCODE_PROPS_DONE;
+
+  return !t->out->failed;
+}
+
+static EJBool ej_transcode_eobject(gpointer user_data) {
+  ((EJTranscoder *)user_data)->eobject = true;
+  return true;
+}
+
+static EJBool ej_transcode_key(const EJString *data, size_t len, gpointer user_data) {
+  EJTranscodeFrame *frame = ej_transcode_top(user_data);
+
+  if (frame->key == NULL) { frame->key = ej_string_new(""); }
+  ej_string_truncate(frame->key, 0);
+  ej_string_append_len(frame->key, data, len);
+  frame->state = EJ_TRANSCODE_PENDING;
+
+  return true;
+}
+
+static EJBool ej_transcode_on_string(const EJString *data, size_t len, gpointer user_data) {
+  EJTranscoder *t = user_data;
+
+  ej_transcode_value_begin(t, EJ_STRING);
+  ej_sink_append_escaped(t->out, data, len);
+
+  return ej_transcode_value_end(t);
+}
+
+static EJBool ej_transcode_number(const EJNumber *data, gpointer user_data) {
+  EJTranscoder *t = user_data;
+
+  ej_transcode_value_begin(t, EJ_NUMBER);
+  ej_write_number((EJNumber *)data, t->out);
+
+  return ej_transcode_value_end(t);
+}
+
+static EJBool ej_transcode_boolean(EJBool data, gpointer user_data) {
+  EJTranscoder *t = user_data;
+
+  ej_transcode_value_begin(t, EJ_BOOLEAN);
+  if (data) {
+    ej_sink_append_str(t->out, "true");
+  }
+  else {
+    ej_sink_append_str(t->out, "false");
+  }
+
+  return ej_transcode_value_end(t);
+}
+
+static EJBool ej_transcode_null(gpointer user_data) {
+  EJTranscoder *t = user_data;
+
+  ej_transcode_value_begin(t, EJ_NULL);
+  ej_sink_append_str(t->out, "null");
+
+  return ej_transcode_value_end(t);
+}
+
+static const EJHandler ej_transcode_handler = {
+  ej_transcode_begin_object, ej_transcode_end_object,
+  ej_transcode_begin_array, ej_transcode_end_array,
+  ej_transcode_begin_props, ej_transcode_end_props,
+  ej_transcode_eobject, ej_transcode_key, ej_transcode_on_string,
+  ej_transcode_number, ej_transcode_boolean, ej_transcode_null
+};
+
+EJ_MODULE_EXPORT(EJBool) ej_transcode(EJSink *sink, EJError **error, const EJString *content) {
+  EJTranscoder t = { sink, NULL, 0, 0, false };
+  EJBool ret;
+  size_t i;
+
+  ej_return_val_if_fail(sink != NULL, false);
+
+  ret = ej_parse_events(&ej_transcode_handler, &t, error, content);
+
+  for (i = 0; i < t.size_frames; i++) {
+    if (t.frames[i].key) { ej_string_free(t.frames[i].key, true); }
+    if (t.frames[i].captured) {
+      ej_sink_free(t.frames[i].capture);
+      ej_string_free(t.frames[i].captured, true);
+    }
+  }
+  ej_free(t.frames);
+
+  return ret;
+}
+
+EJ_MODULE_EXPORT(EJString*) ej_transcode_string(EJError **error, const EJString *content) {
+  GString *out = ej_string_new("");
+  EJBool ret = false;
+
+  EJ_WRITE_STRING(out, ret = ej_transcode(&sink, error, content));
+  if (!ret) {
+    ej_string_free(out, true);
+    return NULL;
+  }
+
+  return ej_string_free(out, false);
+}
+
+/* import, standard json in the layout ej_transcode writes is read back into
+ * pairs with props. the members of an object stay on the parse stack until it
+ * closes, a node takes its parts from there and no object is built for it. */
+typedef enum _EJ_IMPORT_CONTEXT EJ_IMPORT_CONTEXT;
+
+enum _EJ_IMPORT_CONTEXT {
+  /* only {"@": {...}} is recognized */
+  EJ_IMPORT_VALUE,
+  /* the value of a pair, an object with "properties" fills the pair */
+  EJ_IMPORT_PAIR,
+  /* an element of "children", a node has a "name" too */
+  EJ_IMPORT_CHILD,
+  /* the value of "children", an array of nodes becomes an object */
+  EJ_IMPORT_CHILDREN,
+};
+
+static EJBool ej_import_value(EJBuffer *buffer, EJValue **data, EJ_IMPORT_CONTEXT context, EJObjectPair *node);
+static EJBool ej_import_object(EJBuffer *buffer, EJValue **data, EJ_IMPORT_CONTEXT context, EJObjectPair *node);
+
+static EJBool ej_import_key_is(EJObjectPair *pair, const EJString *key) {
+  return pair->key->type == EJ_STRING && strcmp(pair->key->v.string, key) == 0;
+}
+
+/* an "@{...}" key is the standard json of an '@' key, anything else stays a string */
+static void ej_import_key(EJBuffer *buffer, EJValue *key) {
+  EJBuffer *sub;
+  EJValue *value = NULL;
+  EJBool ret;
+
+  if (key->type != EJ_STRING || key->v.string[0] != '@' || key->v.string[1] != '{') { return; }
+
+  sub = ej_buffer_new(key->v.string + 1, ej_strlen(key->v.string + 1));
+  sub->arena = buffer->arena;
+  sub->options = EJ_PARSE_STRICT;
+
+  ret = ej_import_object(sub, &value, EJ_IMPORT_VALUE, NULL) && !ej_dialect_skip_whitespace(sub, EJ_PARSE_STRICT);
+  if (sub->error->message != NULL) {
+    ej_free(sub->error->message);
+    sub->error->message = NULL;
+  }
+  ej_free_buffer(sub);
+
+  if (!ret || value->type != EJ_OBJECT) {
+    if (value != NULL) { ej_buffer_free_value(buffer, value); }
+    return;
+  }
+
+  if (!(key->flags & EJ_VALUE_FLAG_BORROWED) && buffer->arena == NULL) {
+    ej_free(key->v.string);
+  }
+  key->type = EJ_EOBJECT;
+  key->flags = 0;
+  key->v.object = value->v.object;
+  value->v.object = NULL;
+  ej_buffer_free_value(buffer, value);
+}
+
+static EJValue *ej_import_string_new(EJBuffer *buffer, const EJString *str) {
+  EJValue *value = ej_buffer_new0(buffer, EJValue, 1);
+
+  value->type = EJ_STRING;
+  value->v.string = ej_buffer_strndup(buffer, str, strlen(str));
+
+  return value;
+}
+
+static void ej_import_push_pair(EJBuffer *buffer, const EJString *key, EJValue *value) {
+  EJObjectPair *pair = ej_buffer_new0(buffer, EJObjectPair, 1);
+
+  pair->key = ej_import_string_new(buffer, key);
+  pair->value = value;
+  ej_buffer_stack_push(buffer, pair);
+}
+
+/* a node of "children" back to its object, when the array turns out to hold other values too */
+static EJValue *ej_import_node_value(EJBuffer *buffer, EJObjectPair *node) {
+  EJValue *value, *props;
+  size_t mark;
 
-  if (ej_parse_string(buffer, &kv->v.string)) {
-    kv->type = EJ_STRING;
-    goto success;
+  props = ej_buffer_new0(buffer, EJValue, 1);
+  props->type = EJ_ARRAY;
+  mark = ej_buffer_stack_mark(buffer);
+  if (node->props != NULL) {
+    value = ej_buffer_new0(buffer, EJValue, 1);
+    value->type = EJ_OBJECT;
+    value->v.object = node->props;
+    ej_buffer_stack_push(buffer, value);
   }
+  props->v.array = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_value);
 
-  kv->type = EJ_STRING;
-  if (!ej_parse_key_without_quote(buffer, &kv->v.string)) {
-    goto fail;
-  }
+  value = ej_buffer_new0(buffer, EJValue, 1);
+  value->type = EJ_OBJECT;
+  ej_import_push_pair(buffer, "name", node->key);
+  ej_import_push_pair(buffer, "properties", props);
+  ej_import_push_pair(buffer, node->value->type == EJ_ARRAY || node->value->type == EJ_OBJECT ? "children" : "value", node->value);
+  value->v.object = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_object_pair);
 
-  if (!ej_valid(buffer, 1)) {
-    ej_set_error(buffer, "Occour buffer end when parse key.");
-    goto fail;
+  node->key = NULL;
+  node->props = NULL;
+  node->value = NULL;
+  ej_buffer_free_object_pair(buffer, node);
+
+  return value;
+}
+
+/* the "children" of an object which is not a node after all, the array again */
+static void ej_import_nodes_revert(EJBuffer *buffer, EJValue *data) {
+  EJObject *obj = data->v.object;
+  size_t i, mark = ej_buffer_stack_mark(buffer);
+
+  for (i = 0; i < obj->len; i++) {
+    ej_buffer_stack_push(buffer, ej_import_node_value(buffer, obj->pdata[i]));
+    obj->pdata[i] = NULL;
+  }
+  obj->len = 0;
+  if (buffer->arena == NULL) {
+    ej_free_object(obj);
   }
 
-success:
-  *data = kv;
-  return true;
-fail:
-  ej_free_value(kv);
-  return false;
+  data->type = EJ_ARRAY;
+  data->v.array = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_value);
 }
 
-static EJBool ej_parse_number_inner(EJBuffer *buffer, EJNumber **data) {
-  EJNumber *num;
-  size_t len;
-  EJString c;
-  EJString *nstr;
+/* the members since mark as a node, false when they are not one. "properties"
+ * is [] or [{...}], then "children" with an array or "value" with anything.
+ * nodes is the "children" whose array of nodes was made their object */
+static EJBool ej_import_node(EJBuffer *buffer, size_t mark, EJBool named, EJObjectPair *nodes, EJObjectPair *node) {
+  EJObjectPair *pair, *name = NULL, *props = NULL, *value = NULL;
+  EJArray *arr;
+  size_t i;
+
+  if (buffer->stack->len - mark != (named ? 3 : 2)) { return false; }
+
+  for (i = mark; i < buffer->stack->len; i++) {
+    pair = buffer->stack->pdata[i];
+    if (pair->props != NULL || pair->key->type != EJ_STRING) { return false; }
 
-  size_t type = EJ_INT;
-  for (len = 0; (c = ej_read_c(buffer, len)) != '\0'; len++) {
-    if (c == '.') {
-      if (type == EJ_DOUBLE) { goto fail; }
-      type = EJ_DOUBLE;
+    if (named && name == NULL && ej_import_key_is(pair, "name")) {
+      if (pair->value->type != EJ_STRING) { return false; }
+      name = pair;
     }
-    else if (ej_ascii_isdigit(c)
-      || c == '+'
-      || c == '-'
-      || c == 'E'
-      || c == 'e') {
+    else if (props == NULL && ej_import_key_is(pair, "properties")) {
+      if (pair->value->type != EJ_ARRAY) { return false; }
+      arr = pair->value->v.array;
+      if (arr->len > 1) { return false; }
+      if (arr->len == 1 && ((EJValue *)arr->pdata[0])->type != EJ_OBJECT) { return false; }
+      props = pair;
+    }
+    else if (value == NULL && ej_import_key_is(pair, "children")) {
+      if (pair->value->type != EJ_ARRAY && pair != nodes) { return false; }
+      value = pair;
+    }
+    else if (value == NULL && ej_import_key_is(pair, "value")) {
+      value = pair;
     }
     else {
-      break;
+      return false;
     }
   }
-  if (len == 0) { ej_set_error(buffer, "Zero length of number"); return false; };
 
-  num = ej_new0(EJNumber, 1);
-  nstr = ej_strndup(ej_read_inner(buffer, 0), len);
-
-  if (type == EJ_DOUBLE) {
-    num->v.d = ej_ascii_strtod(nstr, NULL);
+  /* a plain pair of the object a node holds is written with no properties too */
+  arr = props->value->v.array;
+  if (arr->len == 1) {
+    node->props = ((EJValue *)arr->pdata[0])->v.object;
+    ((EJValue *)arr->pdata[0])->v.object = NULL;
   }
-  else if (type == EJ_INT) {
-    num->v.i = (int)ej_ascii_strtoll(nstr, NULL, 10);
+  else if (!named) {
+    node->props = ej_buffer_stack_pop_array(buffer, buffer->stack->len, (GDestroyNotify)ej_free_object_pair);
   }
-  ej_free(nstr);
-  ej_buffer_skip(buffer, len);
-
-  num->type = type;
-  *data = num;
-  return true;
-fail:
-  ej_set_error(buffer, "Parse number failed");
-  return false;
-}
-
-EJ_MODULE_EXPORT(EJBool) ej_parse_number(EJBuffer *buffer, EJNumber **data) {
-  if (!ej_token_is(buffer, EJ_TOKEN_HYPHEN) && !ej_ascii_isdigit(*ej_read_inner(buffer, 0))) {
-    return false;
+  if (value == nodes) {
+    arr = nodes->value->v.object;
+    for (i = 0; i < arr->len; i++) {
+      ej_import_key(buffer, ((EJObjectPair *)arr->pdata[i])->key);
+    }
+  }
+  node->value = value->value;
+  value->value = NULL;
+  if (named) {
+    node->key = name->value;
+    name->value = NULL;
   }
 
-  return ej_parse_number_inner(buffer, data);
+  ej_buffer_stack_discard(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  return true;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_parse_object_props(EJBuffer *buffer, EJObject *object, EJArray **data) {
-  EJArray *props = NULL;
-  EJObjectPair *pair = NULL;
+/* standard json, an array of nodes under "children" becomes their object. the
+ * names are still strings, the node holding them reads them as keys */
+static EJBool ej_import_array(EJBuffer *buffer, EJValue *data, EJBool children) {
+  size_t i, mark, n_nodes = 0;
+  EJObjectPair *node = NULL;
+  EJValue *value = NULL;
 
-  ej_assert(ej_token_is(buffer, EJ_TOKEN_LT) && (object != NULL));
   ej_buffer_skip(buffer, 1);
-  if (!ej_skip_whitespace(buffer)) { return false; }
 
-  props = ej_pair_array_new();
-  if (ej_ensure_char(buffer, EJ_TOKEN_GT)) {
-    goto success;
-  }
+  mark = ej_buffer_stack_mark(buffer);
+  if (ej_dialect_ensure_char(buffer, EJ_TOKEN_BKT_END, EJ_PARSE_STRICT)) { goto success; }
 
   while (true) {
-    if (!ej_valid(buffer, 1)) {
-      goto fail;
+    if (children) {
+      node = ej_buffer_new0(buffer, EJObjectPair, 1);
     }
-
-    pair = ej_object_pair_new();
-    /* parse key */
-    if (!ej_parse_key(buffer, &pair->key)) {
-      ej_free_object_pair(pair);
+    if (!ej_import_value(buffer, &value, children ? EJ_IMPORT_CHILD : EJ_IMPORT_VALUE, node)) {
+      if (node != NULL) { ej_buffer_free_object_pair(buffer, node); }
       goto fail;
     }
 
-    if (!ej_skip_whitespace(buffer)) { goto fail; }
-
-    if (ej_token_is(buffer, EJ_TOKEN_LT)) {
-      if (!ej_parse_object_props(buffer, props, &pair->props)) {
-        ej_free_object_pair(pair);
-        ej_set_error(buffer, "Parse property failed");
-        goto fail;
-      }
-    }
-
-    if (!ej_token_is(buffer, EJ_TOKEN_COLON)) {
-      ej_set_error(buffer, "Missing ':' before parse key property value");
-      ej_free_object_pair(pair);
-      goto fail;
+    if (value == NULL && n_nodes == buffer->stack->len - mark) {
+      ej_buffer_stack_push(buffer, node);
+      n_nodes++;
     }
-    ej_buffer_skip(buffer, 1);
+    else {
+      /* not all nodes, the ones so far are objects again */
+      for (i = 0; i < n_nodes; i++) {
+        buffer->stack->pdata[mark + i] = ej_import_node_value(buffer, buffer->stack->pdata[mark + i]);
+      }
+      n_nodes = 0;
 
-    /* parse value */
-    if (!ej_parse_value(buffer, &pair->value)) {
-      ej_set_error(buffer, "Parse property value failed");
-      ej_free_object_pair(pair);
-      goto fail;
+      if (value == NULL) {
+        value = ej_import_node_value(buffer, node);
+      }
+      else if (node != NULL) {
+        ej_buffer_free_object_pair(buffer, node);
+      }
+      ej_buffer_stack_push(buffer, value);
     }
-    ej_ptr_array_add(props, pair);
+    node = NULL;
+    value = NULL;
 
-    if (ej_token_is(buffer, EJ_TOKEN_COMMA)) {
+    if (ej_dialect_ensure_char(buffer, EJ_TOKEN_COMMA, EJ_PARSE_STRICT)) {
       ej_buffer_skip(buffer, 1);
-      if (ej_ensure_char(buffer, EJ_TOKEN_GT)) {
+
+      if (ej_dialect_ensure_char(buffer, EJ_TOKEN_BKT_END, EJ_PARSE_STRICT)) {
+        if (!ej_dialect_trailing_comma(buffer, EJ_PARSE_STRICT)) { goto fail; }
         break;
       }
-    } else if (ej_token_is(buffer, EJ_TOKEN_GT)) {
+    }
+    else if (ej_token_is(buffer, EJ_TOKEN_BKT_END)) {
       break;
-
-    } else {
+    }
+    else {
       goto fail;
     }
   }
 
 success:
-  if (!ej_token_is(buffer, EJ_TOKEN_GT)) {
+  if (!ej_token_is(buffer, EJ_TOKEN_BKT_END)) {
     goto fail;
   }
   ej_buffer_skip(buffer, 1);
 
-  *data = props;
+  if (n_nodes > 0) {
+    data->type = EJ_OBJECT;
+    data->v.object = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  }
+  else {
+    data->type = EJ_ARRAY;
+    data->v.array = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_value);
+  }
   return true;
-
 fail:
-  ej_free_ptr_array(props);
+  ej_set_error(buffer, "Parse array failed");
+  ej_buffer_stack_discard(buffer, mark, n_nodes > 0 ? (GDestroyNotify)ej_free_object_pair : (GDestroyNotify)ej_free_value);
   return false;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_parse_object_pair(EJBuffer *buffer, EJObject *obj, EJObjectPair **data) {
+/* children when a "children" array of nodes may become their object, nodes tells it did */
+static EJBool ej_import_pair(EJBuffer *buffer, EJObjectPair **data, EJBool children, EJBool *nodes) {
   EJObjectPair *pair;
+  EJValue *value = NULL;
 
-  if (!ej_skip_whitespace(buffer)) { return false; }
-
-  pair = ej_object_pair_new();
-  /* parse key */
-  if (!ej_parse_key(buffer, &pair->key)) {
+  pair = ej_buffer_new0(buffer, EJObjectPair, 1);
+  pair->key = ej_buffer_new0(buffer, EJValue, 1);
+  pair->key->type = EJ_STRING;
+  if (!ej_token_is(buffer, EJ_TOKEN_QMARK)) {
+    ej_set_error(buffer, "Key should be a quoted string");
     goto fail;
   }
-
-  if (ej_ensure_char(buffer, EJ_TOKEN_LT)) {
-    if (!ej_parse_object_props(buffer, obj, &pair->props)) {
-      goto fail;
-    }
+  if (!ej_parse_string_inner(buffer, &pair->key->v.string, &pair->key->flags, true)) {
+    goto fail;
   }
 
-  if (!ej_ensure_char(buffer, EJ_TOKEN_COLON)) {
+  if (!ej_dialect_ensure_char(buffer, EJ_TOKEN_COLON, EJ_PARSE_STRICT)) {
     ej_set_error(buffer, "Missing ':' before parse object value");
     goto fail;
   }
   ej_buffer_skip(buffer, 1);
 
-  /* parse value */
-  if (!ej_parse_value(buffer, &pair->value)) {
+  children = children && ej_import_key_is(pair, "children") &&
+             ej_dialect_ensure_char(buffer, EJ_TOKEN_BKT_START, EJ_PARSE_STRICT);
+  if (!ej_import_value(buffer, &value, children ? EJ_IMPORT_CHILDREN : EJ_IMPORT_PAIR, pair)) {
     goto fail;
   }
+  /* NULL when the value was a node and filled the pair */
+  if (value != NULL) {
+    pair->value = value;
+    *nodes = children && value->type == EJ_OBJECT;
+  }
+  ej_import_key(buffer, pair->key);
 
   *data = pair;
   return true;
 fail:
-  ej_free_object_pair(pair);
+  ej_buffer_free_object_pair(buffer, pair);
   return false;
 }
 
-static EJBool ej_parse_object_inner(EJBuffer *buffer, EJObject **data) {
-  EJObject *obj = NULL;
-  EJObjectPair *pair = NULL;
+/* *data is NULL when the object was a node and filled node instead. only an
+ * object starting the way ej_transcode writes a node reads "children" as nodes */
+static EJBool ej_import_object(EJBuffer *buffer, EJValue **data, EJ_IMPORT_CONTEXT context, EJObjectPair *node) {
+  size_t mark;
+  EJObjectPair *pair = NULL, *nodes = NULL;
+  EJBool children = false, converted = false;
+  EJValue *value;
 
   ej_buffer_skip(buffer, 1);
-  if (!ej_skip_whitespace(buffer)) { return false; }
+  if (!ej_dialect_skip_whitespace(buffer, EJ_PARSE_STRICT)) { return false; }
 
-  obj = ej_pair_array_new();
+  mark = ej_buffer_stack_mark(buffer);
 
   if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
     goto success;
   }
 
   while (true) {
-    if (!ej_parse_object_pair(buffer, obj, &pair)) {
+    if (!ej_import_pair(buffer, &pair, children, &converted)) {
       goto fail;
     }
+    if (buffer->stack->len == mark) {
+      children = (context == EJ_IMPORT_PAIR && ej_import_key_is(pair, "properties")) ||
+                 (context == EJ_IMPORT_CHILD && ej_import_key_is(pair, "name"));
+    }
+    if (converted) {
+      nodes = pair;
+      converted = false;
+    }
 
-    if (!ej_skip_whitespace(buffer)) {
-      ej_free_object_pair(pair);
+    if (!ej_dialect_skip_whitespace(buffer, EJ_PARSE_STRICT)) {
+      ej_buffer_free_object_pair(buffer, pair);
       goto fail;
     }
 
-    ej_ptr_array_add(obj, pair);
+    ej_buffer_stack_push(buffer, pair);
     if (ej_token_is(buffer, EJ_TOKEN_COMMA)) {
       ej_buffer_skip(buffer, 1);
 
-      if (!ej_skip_whitespace(buffer)) { goto fail; }
+      if (!ej_dialect_skip_whitespace(buffer, EJ_PARSE_STRICT)) { goto fail; }
       if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
+        if (!ej_dialect_trailing_comma(buffer, EJ_PARSE_STRICT)) { goto fail; }
         break;
       }
-    } 
+    }
     else if (ej_token_is(buffer, EJ_TOKEN_CUR_END)) {
       break;
 
@@ -1127,123 +6725,292 @@ success:
   }
   ej_buffer_skip(buffer, 1);
 
-  *data = obj;
+  if (context != EJ_IMPORT_VALUE && ej_import_node(buffer, mark, context == EJ_IMPORT_CHILD, nodes, node)) {
+    *data = NULL;
+    return true;
+  }
+  if (nodes != NULL) {
+    ej_import_nodes_revert(buffer, nodes->value);
+  }
+
+  pair = buffer->stack->len - mark == 1 ? buffer->stack->pdata[mark] : NULL;
+  if (pair != NULL && pair->props == NULL && ej_import_key_is(pair, "@") && pair->value->type == EJ_OBJECT) {
+    value = pair->value;
+    value->type = EJ_EOBJECT;
+    pair->value = NULL;
+    ej_buffer_stack_discard(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  }
+  else {
+    value = ej_buffer_new0(buffer, EJValue, 1);
+    value->type = EJ_OBJECT;
+    value->v.object = ej_buffer_stack_pop_array(buffer, mark, (GDestroyNotify)ej_free_object_pair);
+  }
+
+  *data = value;
   return true;
 fail:
-  ej_free_ptr_array(obj);
+  ej_buffer_stack_discard(buffer, mark, (GDestroyNotify)ej_free_object_pair);
 
   return false;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_parse_object(EJBuffer *buffer, EJObject **data) {
-  if (!ej_token_is(buffer, EJ_TOKEN_CUR_START)) {
-    return false;
+static EJBool ej_import_value(EJBuffer *buffer, EJValue **data, EJ_IMPORT_CONTEXT context, EJObjectPair *node) {
+  EJValue *value;
+
+  if (!ej_dialect_skip_whitespace(buffer, EJ_PARSE_STRICT)) { return false; }
+
+  if (ej_read_c_inner(buffer, 0) == '{') {
+    if (!ej_import_object(buffer, data, context == EJ_IMPORT_CHILDREN ? EJ_IMPORT_PAIR : context, node)) {
+      ej_set_error(buffer, "Parse value failed");
+      return false;
+    }
+    return true;
   }
 
-  return ej_parse_object_inner(buffer, data);
+  value = ej_buffer_new0(buffer, EJValue, 1);
+  value->type = ej_lex_value(buffer);
+
+  switch (value->type) {
+    case EJ_BOOLEAN:
+      ej_parse_bool(buffer, &value->v.bvalue);
+      ej_buffer_skip(buffer, (value->v.bvalue ? 4 : 5));
+      break;
+    case EJ_NULL:
+      ej_buffer_skip(buffer, 4);
+      break;
+    case EJ_NUMBER:
+      if (!ej_parse_number_inner(buffer, &value->v.number)) {
+        goto fail;
+      }
+      break;
+    case EJ_STRING:
+      if (!ej_parse_string_inner(buffer, &value->v.string, &value->flags, false)) {
+        goto fail;
+      }
+      break;
+    case EJ_ARRAY:
+      if (!ej_import_array(buffer, value, context == EJ_IMPORT_CHILDREN)) {
+        goto fail;
+      }
+      break;
+    default:
+      ej_set_error(buffer, "Value should starts with '[' or '{' or '\"' or boolean");
+      goto fail;
+  }
+  *data = value;
+  return true;
+fail:
+  ej_set_error(buffer, "Parse value failed");
+  ej_buffer_free_value(buffer, value);
+  return false;
 }
 
-EJ_MODULE_EXPORT(EJBool) ej_parse_value(EJBuffer *buffer, EJValue **data) {
-  EJValue *value = ej_new0(EJValue, 1);
+EJ_MODULE_EXPORT(EJValue*) ej_import_json_tree(EJError **error, const EJString *content) {
+  EJBuffer *buffer;
+  EJValue *value = NULL;
 
-  value->type = EJ_RAW;
-  ej_assert(data != NULL && buffer != NULL && buffer->content != NULL);
+  buffer = ej_buffer_new(content, ej_strlen((const EJString *)content));
+  buffer->options = EJ_PARSE_STRICT;
+  ej_skip_utf8_bom(buffer);
+
+  if (!ej_finish_buffer(buffer, ej_import_value(buffer, &value, EJ_IMPORT_VALUE, NULL), error)) {
+    return NULL;
+  }
+  return value;
+}
 
-  if (!ej_skip_whitespace(buffer)) { return false; }
+/* many, the documents of a stream are found by skipping over their brackets
+ * and quotes, then parsed by a pool in batches and delivered in order */
+static EJBool ej_many_next(EJMany *many, size_t *start, size_t *end) {
+  EJBuffer *scan = many->scan;
 
-  if (ej_parse_bool(buffer, &value->v.bvalue)) {
-    *data = value;
-    value->type = EJ_BOOLEAN;
-    ej_buffer_skip(buffer, (value->v.bvalue ? 4 : 5));
-    return true;
+  if (many->scanned || !ej_skip_whitespace(scan) || ej_read_c_inner(scan, 0) == '\0') {
+    /* a comment left open at the end holds no document */
+    ej_free(scan->error->message);
+    scan->error->message = NULL;
+    many->scanned = true;
+    return false;
   }
-  else if (ej_token_is(buffer, EJ_TOKEN_NULL)) {
-    *data = value;
-    value->type = EJ_NULL;
-    ej_buffer_skip(buffer, 4);
-    return true;
+
+  *start = scan->offset;
+  *end = ej_cursor_skip_value(scan, *start);
+  if (*end == 0) {
+    /* unbalanced, the parser reports where the rest of the stream fails */
+    ej_free(scan->error->message);
+    scan->error->message = NULL;
+    *end = many->length;
   }
 
-  if (ej_token_is(buffer, EJ_TOKEN_HYPHEN) || ej_ascii_isdigit(*ej_read_inner(buffer, 0))) {
-    value->type = EJ_NUMBER;
-    if (!ej_parse_number_inner(buffer, &value->v.number)) {
-      goto fail;
-    }
+  scan->offset = *end;
+  many->scanned = *end == many->length;
+  return true;
+}
+
+static void ej_many_fill(EJMany *many, EJManyTask *task, size_t first) {
+  size_t bytes = 0;
+
+  task->many = many;
+  task->first = first;
+  task->n = 0;
+  task->done = false;
+
+  while (task->n < EJ_MANY_BATCH && bytes < EJ_MANY_BATCH_BYTES
+         && ej_many_next(many, &task->starts[task->n], &task->ends[task->n])) {
+    bytes += task->ends[task->n] - task->starts[task->n];
+    task->n++;
   }
-  else if (ej_token_is(buffer, EJ_TOKEN_QMARK)) {
-    value->type = EJ_STRING;
-    if (!ej_parse_string_inner(buffer, &value->v.string)) {
-      goto fail;
-    }
+}
+
+static void ej_many_run(gpointer data, gpointer user_data) {
+  EJManyTask *task = data;
+  EJMany *many = task->many;
+  EJBuffer *buffer;
+  size_t i;
+
+  for (i = 0; i < task->n; i++) {
+    task->errors[i] = NULL;
+    buffer = ej_buffer_new(many->content + task->starts[i], task->ends[i] - task->starts[i]);
+    task->values[i] = ej_parse_buffer(buffer, &task->errors[i]);
   }
-  else if (ej_token_is(buffer, EJ_TOKEN_BKT_START)) {
-    value->type = EJ_ARRAY;
-    if (!ej_parse_array_inner(buffer, &value->v.array)) {
-      goto fail;
-    }
+
+  ej_mutex_lock(&many->mutex);
+  task->done = true;
+  ej_cond_broadcast(&many->cond);
+  ej_mutex_unlock(&many->mutex);
+}
+
+/* errors count rows and columns from the start of their document, make them absolute */
+static void ej_many_position(EJMany *many, size_t start, EJError *error) {
+  size_t row, col;
+
+  ej_buffer_position(many->scan, start, &row, &col);
+  if (error->row == 1) {
+    error->col += col - 1;
   }
-  else if (ej_token_is(buffer, EJ_TOKEN_CUR_START)) {
-    value->type = EJ_OBJECT;
-    if (!ej_parse_object_inner(buffer, &value->v.object)) {
-      goto fail;
-    }
+  error->row += row - 1;
+}
+
+EJ_MODULE_EXPORT(size_t) ej_parse_many_foreach(const EJString *content, size_t len, guint n_threads,
+                                               EJManyFunc func, gpointer user_data) {
+  EJMany many;
+  EJManyTask *tasks;
+  GThreadPool *pool;
+  size_t n_tasks, head = 0, n_running = 0, n_docs = 0, delivered = 0, i;
+  EJBool stopped = false;
+  EJManyTask *task;
+
+  ej_return_val_if_fail(content != NULL && func != NULL, 0);
+
+  if (n_threads == 0) {
+    n_threads = ej_get_num_processors();
   }
-  else if(ej_token_is(buffer, EJ_TOKEN_AT)) {
-    value->type = EJ_EOBJECT;
 
-    ej_buffer_skip(buffer, 1);
-    ej_skip_whitespace(buffer);
+  many.content = content;
+  many.length = len;
+  many.scan = ej_buffer_new(content, len);
+  many.scanned = false;
+  ej_mutex_init(&many.mutex);
+  ej_cond_init(&many.cond);
+  ej_skip_utf8_bom(many.scan);
 
-    if (!ej_parse_object_inner(buffer, &value->v.object)) {
-      goto fail;
+  /* a ring of tasks, a few per thread so the workers don't wait for the delivery */
+  n_tasks = n_threads * EJ_MANY_TASKS_PER_THREAD;
+  tasks = ej_new0(EJManyTask, n_tasks);
+  /* one thread parses on the caller, handing batches over would only add the switching */
+  pool = n_threads > 1 ? ej_thread_pool_new(ej_many_run, NULL, n_threads, false) : NULL;
+
+  while (true) {
+    while (!stopped && !many.scanned && n_running < n_tasks) {
+      task = &tasks[(head + n_running) % n_tasks];
+      ej_many_fill(&many, task, n_docs);
+      if (task->n == 0) { break; }
+
+      n_docs += task->n;
+      n_running++;
+      if (pool != NULL) {
+        ej_thread_pool_push(pool, task);
+      }
+      else {
+        ej_many_run(task, NULL);
+      }
+    }
+    if (n_running == 0) { break; }
+
+    task = &tasks[head];
+    ej_mutex_lock(&many.mutex);
+    while (!task->done) {
+      ej_cond_wait(&many.cond, &many.mutex);
+    }
+    ej_mutex_unlock(&many.mutex);
+
+    for (i = 0; i < task->n; i++) {
+      if (stopped) {
+        if (task->values[i] != NULL) {
+          ej_free_value(task->values[i]);
+        }
+        ej_free_error(task->errors[i]);
+        continue;
+      }
+
+      if (task->errors[i] != NULL) {
+        ej_many_position(&many, task->starts[i], task->errors[i]);
+      }
+      delivered++;
+      stopped = !func(task->first + i, task->values[i], task->errors[i], user_data);
     }
+
+    head = (head + 1) % n_tasks;
+    n_running--;
   }
-  else {
-    value->type = EJ_INVALID;
-    ej_set_error(buffer, "Value should starts with '[' or '{' or '\"' or boolean");
-    goto fail;
+
+  if (pool != NULL) {
+    ej_thread_pool_free(pool, false, true);
   }
-  *data = value;
-  return true;
-fail:
-  ej_set_error(buffer, "Parse value failed");
-  ej_free_value(value);
-  return false;
+  ej_free(tasks);
+  ej_cond_clear(&many.cond);
+  ej_mutex_clear(&many.mutex);
+  ej_free_buffer(many.scan);
+
+  return delivered;
 }
 
-EJ_MODULE_EXPORT(EJBuffer*) ej_buffer_mode_new(const EJString *content, size_t len, EJ_MODE_TYPE mode) {
-  ej_return_val_if_fail(content != NULL, NULL);
+typedef struct {
+  EJManyResult *results;
+  size_t n_results;
+  size_t size_results;
+} EJManyCollect;
 
-  EJBuffer *buffer = ej_new0(EJBuffer, 1);
+static EJBool ej_many_collect(size_t index, EJValue *value, EJError *error, gpointer user_data) {
+  EJManyCollect *collect = user_data;
 
-  buffer->content = content;
-  buffer->length = len;
-  buffer->offset = 0;
-  buffer->error = ej_error_new();
-  buffer->mode = mode;
+  if (collect->n_results == collect->size_results) {
+    collect->size_results = collect->size_results > 0 ? collect->size_results * 2 : 64;
+    collect->results = ej_realloc(collect->results, sizeof(EJManyResult) * collect->size_results);
+  }
 
-  return buffer;
+  collect->results[collect->n_results].value = value;
+  collect->results[collect->n_results].error = error;
+  collect->n_results++;
+  return true;
 }
 
-EJ_MODULE_EXPORT(EJBuffer *) ej_buffer_new(const EJString *content, size_t len) {
-  return ej_buffer_mode_new(content, len, EJ_MODE_RECURSIVE);
-}
+EJ_MODULE_EXPORT(EJManyResult*) ej_parse_many(const EJString *content, size_t len, guint n_threads, size_t *n_results) {
+  EJManyCollect collect = { NULL, 0, 0 };
 
-EJ_MODULE_EXPORT(EJValue*) ej_parse(EJError **error, const EJString *content) {
-  EJBuffer *buffer;
-  EJValue *value = NULL;
+  ej_return_val_if_fail(content != NULL && n_results != NULL, NULL);
 
-  buffer = ej_buffer_new(content, ej_strlen((const EJString *)content));
-  ej_skip_utf8_bom(buffer);
+  *n_results = ej_parse_many_foreach(content, len, n_threads, ej_many_collect, &collect);
+  return collect.results;
+}
 
-  if (!ej_parse_value(buffer, &value)) {
-    *error = ej_get_error(buffer);
-    goto fail;
-  }
-  ej_free_buffer(buffer);
-  return value;
+EJ_MODULE_EXPORT(void) ej_free_many(EJManyResult *results, size_t n_results) {
+  size_t i;
 
-fail:
-    ej_free_buffer(buffer);
-    return NULL;
+  for (i = 0; i < n_results; i++) {
+    if (results[i].value != NULL) {
+      ej_free_value(results[i].value);
+    }
+    ej_free_error(results[i].error);
+  }
+  ej_free(results);
 }
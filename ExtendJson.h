@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <gmodule.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -23,15 +24,40 @@ G_BEGIN_DECLS
 #define ej_free_ptr_array(obj) g_ptr_array_unref(obj)
 #define ej_free_object(obj) ej_free_ptr_array(obj)
 #define ej_free(v) g_free(v)
+#define ej_malloc(size) g_malloc(size)
 
 #define ej_ptr_array_new_with_func(func) g_ptr_array_new_with_free_func((GDestroyNotify)func)
+#define ej_ptr_array_new_full(size, func) g_ptr_array_new_full(size, (GDestroyNotify)func)
+#define ej_ptr_array_new() g_ptr_array_new()
+#define ej_ptr_array_set_size(array, size) g_ptr_array_set_size(array, size)
 #define ej_str_equal(v1, v2) g_str_equal(v1, v2)
+#define ej_str_hash g_str_hash
+#define ej_hash_table_new(hash_func, equal_func) g_hash_table_new(hash_func, equal_func)
+#define ej_hash_table_new_full(hash_func, equal_func, key_func, value_func) g_hash_table_new_full(hash_func, equal_func, key_func, value_func)
+#define ej_hash_table_lookup(table, key) g_hash_table_lookup(table, key)
+#define ej_hash_table_insert(table, key, value) g_hash_table_insert(table, key, value)
+#define ej_hash_table_destroy(table) g_hash_table_destroy(table)
+#define ej_mutex_init(mutex) g_mutex_init(mutex)
+#define ej_mutex_clear(mutex) g_mutex_clear(mutex)
+#define ej_mutex_lock(mutex) g_mutex_lock(mutex)
+#define ej_mutex_unlock(mutex) g_mutex_unlock(mutex)
+#define ej_cond_init(cond) g_cond_init(cond)
+#define ej_cond_clear(cond) g_cond_clear(cond)
+#define ej_cond_wait(cond, mutex) g_cond_wait(cond, mutex)
+#define ej_cond_broadcast(cond) g_cond_broadcast(cond)
+#define ej_thread_pool_new(func, user_data, max_threads, exclusive) g_thread_pool_new(func, user_data, max_threads, exclusive, NULL)
+#define ej_thread_pool_push(pool, data) g_thread_pool_push(pool, data, NULL)
+#define ej_thread_pool_free(pool, immediate, wait) g_thread_pool_free(pool, immediate, wait)
+#define ej_get_num_processors() g_get_num_processors()
 #define ej_assert(v) g_assert(v)
 #define ej_ascii_isdigit(c) g_ascii_isdigit(c)
 #define ej_ascii_isalnum(c) g_ascii_isalnum(c)
+#define ej_ascii_xdigit_value(c) g_ascii_xdigit_value(c)
+#define ej_unichar_to_utf8(c, outbuf) g_unichar_to_utf8(c, outbuf)
 #define ej_ascii_strtod(nstr, endptr) g_ascii_strtod(nstr, endptr)
 #define ej_ascii_strtoll(nstr, endptr, base) g_ascii_strtoll(nstr, endptr, base)
 #define ej_return_val_if_fail g_return_val_if_fail
+#define ej_return_if_fail g_return_if_fail
 #define ej_strcmp0(str1, str2) g_strcmp0(str1, str2)
 #define ej_strdup_vprintf g_strdup_vprintf
 #define ej_strdup_printf g_strdup_printf
@@ -41,8 +67,15 @@ G_BEGIN_DECLS
 #define ej_ptr_array_foreach(str, func, user_data) g_ptr_array_foreach(str, func, user_data)
 
 #define ej_string_append(str, astr) g_string_append(str, astr)
+#define ej_string_append_len(str, astr, len) g_string_append_len(str, astr, len)
+#define ej_string_append_c(str, c) g_string_append_c(str, c)
+#define ej_string_append_printf g_string_append_printf
 #define ej_string_free(string, free_segment) g_string_free(string, free_segment)
 #define ej_ptr_array_add(array, data) g_ptr_array_add(array, data)
+#define ej_ptr_array_remove_index(array, index) g_ptr_array_remove_index(array, index)
+#define ej_private_get(key) g_private_get(key)
+#define ej_private_set(key, value) g_private_set(key, value)
+#define ej_realloc(mem, size) g_realloc(mem, size)
 #define ej_strdup(v) g_strdup(v)
 
 #define EJFunc GFunc
@@ -50,9 +83,21 @@ G_BEGIN_DECLS
 G_BEGIN_DECLS
 
 typedef struct _EJBuffer EJBuffer;
+typedef struct _EJArena EJArena;
+typedef struct _EJKeyTable EJKeyTable;
+typedef struct _EJHandler EJHandler;
+typedef struct _EJPushParser EJPushParser;
+typedef struct _EJSink EJSink;
+typedef struct _EJCursor EJCursor;
+typedef struct _EJDocument EJDocument;
+typedef struct _EJTape EJTape;
+typedef struct _EJManyResult EJManyResult;
 typedef enum _EJ_TYPE EJ_TYPE;
+typedef enum _EJ_VALUE_FLAGS EJ_VALUE_FLAGS;
 typedef enum _EJ_TOKEN_TYPE EJ_TOKEN_TYPE;
 typedef enum _EJ_MODE_TYPE EJ_MODE_TYPE;
+typedef enum _EJ_PARSE_OPTION EJ_PARSE_OPTION;
+typedef guint EJParseOptions;
 
 typedef enum _EJ_NUMBER_TYPE EJ_NUMBER_TYPE;
 typedef bool EJBool;
@@ -61,6 +106,7 @@ typedef struct _EJNumber EJNumber;
 typedef struct _GPtrArray EJObject;
 typedef struct _GHashTable EJHash;
 typedef struct _EJObjectPair EJObjectPair;
+typedef struct _EJObjectIndex EJObjectIndex;
 typedef struct _GPtrArray EJArray;
 typedef struct _EJError EJError;
 typedef gchar EJString;
@@ -74,6 +120,31 @@ enum _EJ_NUMBER_TYPE {
 
 enum _EJ_MODE_TYPE {
   EJ_MODE_RECURSIVE,
+  /* explicit heap stack, no C recursion for nested containers */
+  EJ_MODE_ITERATIVE,
+  /* a structural index is built first and the tree is built from it, the
+   * recursive parser takes over for documents it does not cover */
+  EJ_MODE_INDEXED,
+  /* the children of a large top level container are parsed by a pool of threads */
+  EJ_MODE_PARALLEL,
+};
+
+/* the extensions a parse accepts, EJ_PARSE_STRICT is plain json */
+enum _EJ_PARSE_OPTION {
+  EJ_PARSE_STRICT = 0,
+  /* line and block comments wherever whitespace may be */
+  EJ_PARSE_COMMENTS = 1 << 0,
+  /* a ',' before the closing bracket of an array, object or props */
+  EJ_PARSE_TRAILING_COMMAS = 1 << 1,
+  /* keys without quotes */
+  EJ_PARSE_BARE_KEYS = 1 << 2,
+  /* <props> behind keys */
+  EJ_PARSE_PROPS = 1 << 3,
+  /* @ objects as values and keys */
+  EJ_PARSE_EOBJECTS = 1 << 4,
+  EJ_PARSE_JSONC = EJ_PARSE_COMMENTS | EJ_PARSE_TRAILING_COMMAS,
+  /* the default */
+  EJ_PARSE_EXTENDED = EJ_PARSE_JSONC | EJ_PARSE_BARE_KEYS | EJ_PARSE_PROPS | EJ_PARSE_EOBJECTS,
 };
 
 enum _EJ_TYPE {
@@ -88,6 +159,14 @@ enum _EJ_TYPE {
   EJ_RAW,
 };
 
+enum _EJ_VALUE_FLAGS {
+  EJ_VALUE_FLAG_NONE = 0,
+  /* v.string points into memory the value does not own, eg. an in situ buffer */
+  EJ_VALUE_FLAG_BORROWED = 1 << 0,
+  /* v.string is owned by an EJKeyTable, equal keys share one pointer */
+  EJ_VALUE_FLAG_INTERNED = 1 << 1,
+};
+
 enum _EJ_TOKEN_TYPE {
   EJ_TOKEN_TRUE,
   EJ_TOKEN_FALSE,
@@ -132,6 +211,7 @@ struct _EJNumber {
 
 struct _EJValue {
   EJ_TYPE type;
+  EJ_VALUE_FLAGS flags;
 
   union value {
     EJObject *object;
@@ -142,18 +222,101 @@ struct _EJValue {
   } v;
 };
 
+/* callbacks of ej_parse_events, any of them may be NULL, return false to stop.
+ * strings are borrowed and only valid during the call. an '@' object, as a
+ * value or as a key, is reported as eobject followed by its object events. */
+struct _EJHandler {
+  EJBool (*begin_object)(gpointer user_data);
+  EJBool (*end_object)(gpointer user_data);
+  EJBool (*begin_array)(gpointer user_data);
+  EJBool (*end_array)(gpointer user_data);
+  EJBool (*begin_props)(gpointer user_data);
+  EJBool (*end_props)(gpointer user_data);
+  EJBool (*eobject)(gpointer user_data);
+  EJBool (*key)(const EJString *data, size_t len, gpointer user_data);
+  EJBool (*string)(const EJString *data, size_t len, gpointer user_data);
+  EJBool (*number)(const EJNumber *data, gpointer user_data);
+  EJBool (*boolean)(EJBool data, gpointer user_data);
+  EJBool (*null)(gpointer user_data);
+};
+
+/* a position in the document of a buffer, copy it freely. the fields are
+ * private, cursors of one buffer share its offset and error. */
+struct _EJCursor {
+  EJBuffer *buffer;
+  EJ_TYPE type;
+  /* the value, or the key for a cursor from ej_cursor_key */
+  size_t offset;
+  /* EJ_ARRAY, EJ_OBJECT for members of objects and props, EJ_INVALID for the root and keys */
+  EJ_TYPE parent;
+  /* members, props is 0 when there are none */
+  size_t key;
+  size_t props;
+  EJBool is_key;
+};
+
+/* a value in an EJDocument, copy it freely. the fields are private */
+struct _EJTape {
+  const EJDocument *document;
+  /* tape index of the value, or of the key for a tape from ej_tape_key */
+  size_t index;
+  /* EJ_ARRAY, EJ_OBJECT for members of objects and props, EJ_INVALID for the root and keys */
+  EJ_TYPE parent;
+  /* members, props is 0 when there are none */
+  size_t key;
+  size_t props;
+};
+
+struct _EJManyResult {
+  EJValue *value;
+  EJError *error;
+};
+
+/* a document of ej_parse_many_foreach, value and error belong to the callee,
+ * return false to stop */
+typedef EJBool (*EJManyFunc)(size_t index, EJValue *value, EJError *error, gpointer user_data);
+
+/* a sink hands its staged output over in pieces, return false when they
+ * could not all be written */
+typedef EJBool (*EJSinkWriteFunc)(const EJString *data, size_t len, gpointer user_data);
+typedef EJBool (*EJSinkFlushFunc)(gpointer user_data);
+
 struct _EJLString {
   size_t len;
   EJString *value;
 };
 
 EJ_MODULE_EXPORT(void*)  ej_malloc0(size_t size);
+
+/* arena, nodes parsed with an arena are released together by ej_arena_free,
+ * never pass them to ej_free_value or the g_ptr_array_* mutators. */
+EJ_MODULE_EXPORT(EJArena*) ej_arena_new(size_t block_size);
+EJ_MODULE_EXPORT(void*) ej_arena_alloc0(EJArena *arena, size_t size);
+EJ_MODULE_EXPORT(void) ej_arena_take(EJArena *arena, gpointer data, GDestroyNotify func);
+EJ_MODULE_EXPORT(void) ej_arena_free(EJArena *arena);
+
+/* key table, keys parsed with a table are stored once and shared by every
+ * tree parsed with it, free the trees before the table. */
+EJ_MODULE_EXPORT(EJKeyTable*) ej_key_table_new(void);
+EJ_MODULE_EXPORT(const EJString*) ej_key_table_intern(EJKeyTable *keys, const EJString *key);
+EJ_MODULE_EXPORT(void) ej_key_table_free(EJKeyTable *keys);
+
 EJ_MODULE_EXPORT(void) ej_free_value(EJValue *data);
 EJ_MODULE_EXPORT(void) ej_free_error(EJError *error);
 EJ_MODULE_EXPORT(void) ej_free_buffer(EJBuffer *buffer);
 
 EJ_MODULE_EXPORT(const EJString *) ej_get_data_type_name(EJ_TYPE type);
 EJ_MODULE_EXPORT(EJBool) ej_object_get_value(EJObject *data, EJString *name, EJValue **value);
+/* a hash index for many lookups in a large object, owned by the caller. it
+ * holds the pairs and keys of the object as they are now, any change to the
+ * object (a pair added, removed or replaced, a key changed) or freeing it
+ * makes the index invalid, free it and build a new one. NULL when a pair has
+ * no key or value. */
+EJ_MODULE_EXPORT(EJObjectIndex*) ej_object_index_new(EJObject *data);
+EJ_MODULE_EXPORT(EJBool) ej_object_index_get_value(EJObjectIndex *index, const EJString *key, EJValue **value);
+EJ_MODULE_EXPORT(void) ej_object_index_free(EJObjectIndex *index);
+/* key must come from the EJKeyTable the object was parsed with */
+EJ_MODULE_EXPORT(EJBool) ej_object_get_interned(EJObject *data, const EJString *key, EJValue **value);
 
 /* reader */
 EJ_MODULE_EXPORT(EJBool) ej_valid(EJBuffer *buffer, int pos);
@@ -163,6 +326,8 @@ EJ_MODULE_EXPORT(EJString) ej_next_c(EJBuffer *buffer);
 EJ_MODULE_EXPORT(void) ej_skip_line(EJBuffer *buffer, int cols, int rows);
 EJ_MODULE_EXPORT(EJBool) ej_skip_whitespace(EJBuffer *buffer);
 EJ_MODULE_EXPORT(EJBool) ej_skip_utf8_bom(EJBuffer *buffer);
+/* false with the offset of the first byte which is not part of a valid sequence */
+EJ_MODULE_EXPORT(EJBool) ej_validate_utf8(const EJString *content, size_t len, size_t *offset);
 EJ_MODULE_EXPORT(void) ej_buffer_skip(EJBuffer *buffer, int pos);
 EJ_MODULE_EXPORT(EJBool) ej_ensure_char(EJBuffer *buffer, EJ_TOKEN_TYPE ch);
 
@@ -178,16 +343,135 @@ EJ_MODULE_EXPORT(EJBool) ej_parse_object(EJBuffer *buffer, EJObject **data);
 EJ_MODULE_EXPORT(EJBool) ej_parse_value(EJBuffer *buffer, EJValue **data);
 EJ_MODULE_EXPORT(void) ej_set_error(EJBuffer *buffer, EJString *fmt, ...);
 EJ_MODULE_EXPORT(EJError*) ej_get_error(EJBuffer *buffer);
+EJ_MODULE_EXPORT(EJBool) ej_offset_to_position(EJBuffer *buffer, size_t offset, size_t *row, size_t *col);
 
 EJ_MODULE_EXPORT(EJBuffer*) ej_buffer_new(const EJString *content, size_t len);
 EJ_MODULE_EXPORT(EJBuffer*) ej_buffer_mode_new(const EJString *content, size_t len, EJ_MODE_TYPE mode);
+EJ_MODULE_EXPORT(EJBuffer*) ej_buffer_insitu_new(EJString *content, size_t len);
+EJ_MODULE_EXPORT(void) ej_buffer_set_arena(EJBuffer *buffer, EJArena *arena);
+EJ_MODULE_EXPORT(void) ej_buffer_set_key_table(EJBuffer *buffer, EJKeyTable *keys);
+/* EJ_MODE_ITERATIVE only, 0 means no limit */
+EJ_MODULE_EXPORT(void) ej_buffer_set_max_depth(EJBuffer *buffer, size_t max_depth);
+/* EJ_MODE_PARALLEL only, 0 for one per processor */
+EJ_MODULE_EXPORT(void) ej_buffer_set_threads(EJBuffer *buffer, guint n_threads);
+/* EJ_MODE_RECURSIVE and EJ_MODE_PARALLEL only, the other modes parse EJ_PARSE_EXTENDED */
+EJ_MODULE_EXPORT(void) ej_buffer_set_options(EJBuffer *buffer, EJParseOptions options);
+/* the whole content is validated by ej_parse_value first, in every mode */
+EJ_MODULE_EXPORT(void) ej_buffer_set_validate_utf8(EJBuffer *buffer, EJBool validate);
 EJ_MODULE_EXPORT(EJArray*) ej_value_array_new();
 EJ_MODULE_EXPORT(EJArray*) ej_pair_array_new();
 EJ_MODULE_EXPORT(EJObjectPair*) ej_object_pair_new();
 
 EJ_MODULE_EXPORT(EJValue*) ej_parse(EJError **error, const EJString *content);
+/* content does not have to be terminated */
+EJ_MODULE_EXPORT(EJValue*) ej_parse_len(EJError **error, const EJString *content, size_t len);
+EJ_MODULE_EXPORT(EJValue*) ej_parse_arena(EJArena *arena, EJError **error, const EJString *content);
+EJ_MODULE_EXPORT(EJBool) ej_parse_events(const EJHandler *handler, gpointer user_data, EJError **error, const EJString *content);
+EJ_MODULE_EXPORT(EJValue*) ej_parse_iterative(size_t max_depth, EJError **error, const EJString *content);
+EJ_MODULE_EXPORT(EJValue*) ej_parse_indexed(EJError **error, const EJString *content);
+/* the tree and errors are the same as ej_parse, without an arena */
+EJ_MODULE_EXPORT(EJValue*) ej_parse_parallel(guint n_threads, EJError **error, const EJString *content);
+/* only the extensions in options are accepted, see EJ_PARSE_OPTION */
+EJ_MODULE_EXPORT(EJValue*) ej_parse_options(EJParseOptions options, EJError **error, const EJString *content);
+EJ_MODULE_EXPORT(EJValue*) ej_parse_keys(EJKeyTable *keys, EJError **error, const EJString *content);
+/* strings point into content, which is modified and must outlive the tree */
+EJ_MODULE_EXPORT(EJValue*) ej_parse_insitu(EJError **error, EJString *content);
+/* consumes bytes, the arena keeps the data the strings point into */
+EJ_MODULE_EXPORT(EJValue*) ej_parse_bytes(EJArena *arena, EJError **error, GBytes *bytes);
+/* maps the file, with an arena its strings point into the mapping which the arena keeps,
+ * without one they are copied and the mapping is dropped after parsing */
+EJ_MODULE_EXPORT(EJValue*) ej_parse_file(EJArena *arena, EJError **error, const gchar *path);
+
+/* many, a stream of documents, one per line or just one after another, is
+ * split and parsed on n_threads workers, 0 for one per processor. results
+ * come in input order with their own error, whose row and col count from
+ * the start of the stream. */
+EJ_MODULE_EXPORT(EJManyResult*) ej_parse_many(const EJString *content, size_t len, guint n_threads, size_t *n_results);
+EJ_MODULE_EXPORT(size_t) ej_parse_many_foreach(const EJString *content, size_t len, guint n_threads,
+                                               EJManyFunc func, gpointer user_data);
+EJ_MODULE_EXPORT(void) ej_free_many(EJManyResult *results, size_t n_results);
+
+/* push parser, the document is fed in chunks of any size and only the
+ * unconsumed tail is kept, the tree and error are the same as ej_parse.
+ * ej_push_feed returns false once the document failed, ej_push_finish
+ * returns the tree or the error, free the parser after it. */
+EJ_MODULE_EXPORT(EJPushParser*) ej_push_parser_new(void);
+EJ_MODULE_EXPORT(EJBool) ej_push_feed(EJPushParser *parser, const EJString *data, size_t len);
+EJ_MODULE_EXPORT(EJValue*) ej_push_finish(EJPushParser *parser, EJError **error);
+EJ_MODULE_EXPORT(void) ej_push_parser_free(EJPushParser *parser);
+
+/* cursor, values are only decoded when they are read and everything else is
+ * skipped over by matching brackets and quotes without being validated, an @
+ * value has to be followed by its '{'. false without an error on the buffer
+ * means there is no such child. */
+EJ_MODULE_EXPORT(EJBool) ej_cursor_init(EJCursor *cursor, EJBuffer *buffer);
+EJ_MODULE_EXPORT(EJ_TYPE) ej_cursor_type(const EJCursor *cursor);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_enter(const EJCursor *cursor, EJCursor *child);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_next(EJCursor *cursor);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_key(const EJCursor *cursor, EJCursor *key);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_props(const EJCursor *cursor, EJCursor *child);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_find_key(const EJCursor *cursor, const EJString *key, EJCursor *child);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_find_prop(const EJCursor *cursor, const EJString *key, EJCursor *child);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_get_string(const EJCursor *cursor, EJString **data);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_get_number(const EJCursor *cursor, EJNumber *data);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_get_bool(const EJCursor *cursor, EJBool *data);
+EJ_MODULE_EXPORT(EJBool) ej_cursor_get_value(const EJCursor *cursor, EJValue **data);
+
+/* transcode, extended json is written as standard json in one pass without
+ * building a tree, in this layout:
+ *   key<props>: value      "key": {"properties": [{props}], "children": value}
+ *   child: value           {"name": "child", "properties": [], "children": value}
+ *                          for every pair of an object which is "children"
+ *   @{...} as a value      {"@": {...}}
+ *   @{...} as a key        "@{...}", the key as a string of its own standard json
+ * a node whose value is not an object or array has "value" instead of
+ * "children", empty props give "properties": []. an empty object has no
+ * nodes to list, so key<p: 1>: {} and key<p: 1>: [] are both written as
+ * "children": [] and ej_import_json_tree reads them back as []. everything
+ * else is written as it is, without comments, trailing commas and bare keys.
+ * the error is the one ej_parse_events gives, a failed write of the sink stops
+ * with "Stopped by handler". */
+EJ_MODULE_EXPORT(EJBool) ej_transcode(EJSink *sink, EJError **error, const EJString *content);
+EJ_MODULE_EXPORT(EJString*) ej_transcode_string(EJError **error, const EJString *content);
+
+/* import, standard json in the layout above is read into pairs with props,
+ * the way back from ej_transcode:
+ *   "key": {"properties": [...], "children": [...] | "value": ...}   key<props>: value
+ *   "children": [{"name": ..., ...}, ...]   an object of those pairs, when every element is a node
+ *   {"@": {...}}                            @{...}
+ *   "@{...}" as a key or "name"             the '@' key it is the standard json of
+ * "properties" is [] or holds one object, [] of a node with a "name" is a pair
+ * without props. "children" is only read as nodes in an object starting with
+ * "properties" or "name", an empty one stays an array. anything else is read
+ * as it is, the document has to be strict json. */
+EJ_MODULE_EXPORT(EJValue*) ej_import_json_tree(EJError **error, const EJString *content);
+
+/* document, the whole parse result in a tape of tagged words and one string
+ * block instead of a node per value. it is parsed as ej_parse_events does and
+ * is read only, ej_tape_to_value builds a tree for code that needs one. */
+EJ_MODULE_EXPORT(EJDocument*) ej_parse_document(EJError **error, const EJString *content);
+EJ_MODULE_EXPORT(size_t) ej_document_size(const EJDocument *doc);
+EJ_MODULE_EXPORT(void) ej_document_free(EJDocument *doc);
+EJ_MODULE_EXPORT(EJBool) ej_document_root(const EJDocument *doc, EJTape *tape);
+EJ_MODULE_EXPORT(EJ_TYPE) ej_tape_type(const EJTape *tape);
+EJ_MODULE_EXPORT(size_t) ej_tape_count(const EJTape *tape);
+EJ_MODULE_EXPORT(EJBool) ej_tape_enter(const EJTape *tape, EJTape *child);
+EJ_MODULE_EXPORT(EJBool) ej_tape_next(EJTape *tape);
+EJ_MODULE_EXPORT(EJBool) ej_tape_key(const EJTape *tape, EJTape *key);
+EJ_MODULE_EXPORT(EJBool) ej_tape_props(const EJTape *tape, EJTape *child);
+EJ_MODULE_EXPORT(EJBool) ej_tape_find_key(const EJTape *tape, const EJString *key, EJTape *child);
+EJ_MODULE_EXPORT(EJBool) ej_tape_find_prop(const EJTape *tape, const EJString *key, EJTape *child);
+EJ_MODULE_EXPORT(const EJString*) ej_tape_get_string(const EJTape *tape, size_t *len);
+EJ_MODULE_EXPORT(EJBool) ej_tape_get_number(const EJTape *tape, EJNumber *data);
+EJ_MODULE_EXPORT(EJBool) ej_tape_get_bool(const EJTape *tape, EJBool *data);
+EJ_MODULE_EXPORT(EJValue*) ej_tape_to_value(const EJTape *tape);
 
 EJ_MODULE_EXPORT(EJBool) ej_print_number(EJNumber *data, EJString **buffer);
+/* the text of a number without allocating, at most EJ_NUMBER_TEXT_SIZE bytes
+ * and not terminated, returns the length. doubles have the fewest digits
+ * which parse back to the same value */
+#define EJ_NUMBER_TEXT_SIZE 32
+EJ_MODULE_EXPORT(size_t) ej_format_number(EJNumber *data, EJString *text);
 EJ_MODULE_EXPORT(EJBool) ej_print_bool(EJBool data, EJString **buffer);
 EJ_MODULE_EXPORT(EJBool) ej_print_array_value(size_t arrlen, size_t index, EJValue *data, EJString **buffer);
 EJ_MODULE_EXPORT(EJBool) ej_print_array(EJArray *data, EJString **buffer);
@@ -195,6 +479,24 @@ EJ_MODULE_EXPORT(EJBool) ej_print_object_pair_prop(EJArray *data, EJString **buf
 EJ_MODULE_EXPORT(EJBool) ej_print_object_pair(EJObjectPair *data, EJString **buffer);
 EJ_MODULE_EXPORT(EJBool) ej_print_object(EJObject *data, EJString **buffer);
 EJ_MODULE_EXPORT(EJBool) ej_print_value(EJValue *data, EJString **buffer);
+/* appends to out in one pass, the same text ej_print_value returns */
+EJ_MODULE_EXPORT(EJBool) ej_write_value(EJValue *data, GString *out);
+/* the exact length ej_write_value appends, eg. for g_string_sized_new */
+EJ_MODULE_EXPORT(size_t) ej_write_value_size(EJValue *data);
+
+/* sink, values are written through a staging buffer of buffer_size bytes,
+ * 0 for 64k, which is handed to write whenever it fills up. memory does not
+ * grow with the document. the calls return false once a write failed,
+ * ej_sink_flush writes what is staged and flushes, call it before ej_sink_free. */
+EJ_MODULE_EXPORT(EJSink*) ej_sink_new(EJSinkWriteFunc write, EJSinkFlushFunc flush, gpointer user_data, size_t buffer_size);
+EJ_MODULE_EXPORT(EJSink*) ej_sink_file_new(FILE *file, size_t buffer_size);
+EJ_MODULE_EXPORT(EJSink*) ej_sink_fd_new(int fd, size_t buffer_size);
+EJ_MODULE_EXPORT(EJSink*) ej_sink_stream_new(GOutputStream *stream, size_t buffer_size);
+EJ_MODULE_EXPORT(EJBool) ej_sink_write_value(EJSink *sink, EJValue *data);
+/* raw bytes between values, eg. a newline */
+EJ_MODULE_EXPORT(EJBool) ej_sink_write(EJSink *sink, const EJString *data, size_t len);
+EJ_MODULE_EXPORT(EJBool) ej_sink_flush(EJSink *sink);
+EJ_MODULE_EXPORT(void) ej_sink_free(EJSink *sink);
 
 G_END_DECLS
 